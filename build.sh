@@ -6,12 +6,14 @@ else
   CC=g++
 fi
 
-WARN="-pedantic -Wall"
+WARN="-std=c++17 -pedantic -Wall -pthread"
 FREETYPE_FLAGS=`freetype-config --cflags --libs`
-SOURCE_FILES="example1 example2 example3"
+SOURCE_FILES="example1 example2 example3 example4 example5 example6 example7 example9 example10 font2svg font2svg_server font2svg_fuzz font2svg_regress"
 
 for sourcefile in $SOURCE_FILES;
   do $CC $WARN $sourcefile".cpp" -o $sourcefile $FREETYPE_FLAGS
 done
 
+# example8 uses the compiled library
+$CC $WARN example8.cpp font_to_svg_api.cpp -o example8 $FREETYPE_FLAGS
 
@@ -0,0 +1,40 @@
+// example10.cpp font_to_svg - public domain
+// the same characters from several fonts, through the conversion pipeline
+
+#include "font_to_svg_pipeline.hpp"
+#include <chrono>
+
+int main( int argc, char * argv[] )
+{
+	if (argc<3) {
+		std::cerr << "usage: " << argv[0] << " 0x41-0x5A file.ttf [file2.ttf ...]\n";
+		std::cerr << "prints the size of each svg, then the time taken\n";
+		exit( 1 );
+	}
+
+	font2svg::quiet = true;
+	std::vector<int> codepoints;
+	int first = strtol( argv[1], NULL, 0 ), last = first;
+	const char *dash = strchr( argv[1] + 1, '-' );
+	if (dash) last = strtol( dash + 1, NULL, 0 );
+	for ( int c = first ; c <= last ; c++ ) codepoints.push_back( c );
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	font2svg::pipeline p( 4 );
+	std::vector< std::future<font2svg::batch_result> > results;
+	for ( int i = 2 ; i < argc ; i++ )
+		results.push_back( p.submit( argv[i], codepoints ) );
+
+	// the fonts are read, loaded and written while we wait for the first
+	for ( size_t i = 0 ; i < results.size() ; i++ ) {
+		font2svg::batch_result r = results[i].get();
+		std::cout << r.font << ":";
+		if (r.error.size()) std::cout << " " << r.error;
+		for ( size_t k = 0 ; k < r.svgs.size() ; k++ ) std::cout << " " << r.svgs[k].size();
+		std::cout << "\n";
+	}
+	double secs = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+	std::cerr << results.size() << " fonts, " << secs << " s\n";
+
+  return 0;
+}
@@ -0,0 +1,36 @@
+// example4.cpp font_to_svg - public domain
+// distance field atlas of a range of characters, written as PGM/PPM
+
+#include "font_to_svg_sdf.hpp"
+
+int main( int argc, char * argv[] )
+{
+	if (argc<3 || argc>5) {
+		std::cerr << "usage: " << argv[0] << " file.ttf 0x0041 [0x005A] [msdf] > atlas.pgm\n";
+		exit( 1 );
+	}
+
+	int first = strtol( argv[2], NULL, 0 );
+	int last = first;
+	font2svg::sdf_options opt;
+	for ( int i = 3 ; i < argc ; i++ ) {
+		if (std::string(argv[i]) == "msdf") opt.msdf = true;
+		else last = strtol( argv[i], NULL, 0 );
+	}
+	opt.size = 64;
+	opt.range = 6;
+
+	std::vector<int> codepoints;
+	for ( int c = first ; c <= last ; c++ ) codepoints.push_back( c );
+
+	font2svg::ttf_file file( argv[1] );
+	font2svg::distance_atlas atlas = font2svg::pack_atlas(
+		font2svg::make_distance_fields( file, codepoints, opt ), opt );
+	for ( size_t i = 0 ; i < atlas.cells.size() ; i++ )
+		std::cerr << "0x" << std::hex << atlas.cells[i].codepoint << std::dec
+			<< " " << atlas.cells[i].x << "," << atlas.cells[i].y << "\n";
+	std::cout << font2svg::netpbm( atlas );
+	file.free();
+
+  return 0;
+}
@@ -0,0 +1,39 @@
+// example5.cpp font_to_svg - public domain
+// one character from several instances of a variable font
+
+#include "font_to_svg_var.hpp"
+
+int main( int argc, char * argv[] )
+{
+	if (argc<3) {
+		std::cerr << "usage: " << argv[0] << " file.ttf 0x0042 [wght=700,wdth=75 ...]\n";
+		std::cerr << "with no axis settings, every named instance is drawn\n";
+		exit( 1 );
+	}
+
+	font2svg::ttf_file file( argv[1] );
+	std::vector<font2svg::var_axis> axes = file.axes();
+	for ( size_t i = 0 ; i < axes.size() ; i++ )
+		std::cerr << axes[i].tag << " (" << axes[i].name << ") "
+			<< axes[i].minimum << " .. " << axes[i].maximum
+			<< " default " << axes[i].def << "\n";
+
+	std::vector<int> codepoints( 1, strtol( argv[2], NULL, 0 ) );
+	font2svg::instance_set set( file, codepoints );
+
+	std::vector< std::vector<double> > coords;
+	for ( int i = 3 ; i < argc ; i++ ) coords.push_back( set.coordinates( argv[i] ) );
+	if (coords.empty()) coords = file.named_instances();
+	if (coords.empty()) coords.push_back( std::vector<double>() );
+
+	std::vector<font2svg::instance> instances = set.render( coords );
+	for ( size_t i = 0 ; i < instances.size() ; i++ ) {
+		std::cout << "\n<!-- instance:";
+		for ( size_t j = 0 ; j < instances[i].coords.size() ; j++ )
+			std::cout << " " << axes[j].tag << "=" << instances[i].coords[j];
+		std::cout << " -->" << instances[i].svgs[0];
+	}
+	file.free();
+
+  return 0;
+}
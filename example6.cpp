@@ -0,0 +1,24 @@
+// example6.cpp font_to_svg - public domain
+// one character out of every face of a .ttc/.otc collection
+
+#include "font_to_svg_ttc.hpp"
+
+int main( int argc, char * argv[] )
+{
+	if (argc!=3) {
+		std::cerr << "usage: " << argv[0] << " file.ttc 0x0042\n";
+		exit( 1 );
+	}
+
+	font2svg::quiet = true;
+	font2svg::font_collection collection( argv[1] );
+	std::cerr << collection.num_faces << " faces in " << argv[1] << "\n";
+
+	std::vector<int> codepoints( 1, strtol( argv[2], NULL, 0 ) );
+	std::vector< std::vector<std::string> > svgs = collection.convert( codepoints );
+	for ( size_t i = 0 ; i < svgs.size() ; i++ )
+		std::cout << "\n<!-- face " << i << " -->" << svgs[i][0];
+	collection.free();
+
+  return 0;
+}
@@ -0,0 +1,39 @@
+// example7.cpp font_to_svg - public domain
+// one character through each of the output policies
+
+#include "font_to_svg.hpp"
+
+int main( int argc, char * argv[] )
+{
+	if (argc!=3) {
+		std::cerr << "usage: " << argv[0] << " file.ttf 0x0042\n";
+		exit( 1 );
+	}
+
+	font2svg::quiet = true;
+	font2svg::glyph g( argv[1], argv[2] );
+
+	font2svg::svg_compact compact;
+	g.emit( compact );
+	std::cout << "compact svg path:\n" << compact.svg.str() << "\n\n";
+
+	font2svg::path_binary binary;
+	g.emit( binary );
+	std::cout << "binary path: " << binary.data.size() << " ints\n\n";
+
+	// 48 pixels high, y already points down after init()
+	int h = 48;
+	double scale = double(h) / g.bbheight;
+	int w = g.bbwidth * scale + 1;
+	font2svg::raster r( w, h, scale, -g.face->bbox.xMin*scale, g.face->bbox.yMax*scale );
+	g.emit( r );
+	r.fill();
+	std::cout << "raster:\n";
+	for ( int y = 0 ; y < h ; y++ ) {
+		for ( int x = 0 ; x < w ; x++ ) std::cout << (r.pixels[y*w+x] ? '#' : '.');
+		std::cout << "\n";
+	}
+	g.free();
+
+  return 0;
+}
@@ -0,0 +1,23 @@
+// example8.cpp font_to_svg - public domain
+// same as example2, through the compiled library and its slim header
+
+#include "font_to_svg_api.hpp"
+#include <iostream>
+#include <cstdlib>
+
+int main( int argc, char * argv[] )
+{
+	if (argc!=3) {
+		std::cerr << "usage: " << argv[0] << " file.ttf 0x0042\n";
+		exit( 1 );
+	}
+
+	font2svg::font f( argv[1] );
+	if (!f.ok()) {
+		std::cerr << "problem loading file " << argv[1] << "\n";
+		exit( 1 );
+	}
+	std::cout << f.svg( strtol( argv[2], NULL, 0 ) );
+
+  return 0;
+}
@@ -0,0 +1,31 @@
+// example9.cpp font_to_svg - public domain
+// characters of a color (emoji) font, with their colors
+
+#include "font_to_svg_color.hpp"
+
+int main( int argc, char * argv[] )
+{
+	if (argc<3) {
+		std::cerr << "usage: " << argv[0] << " file.ttf 0x1F600 [0x1F601 ...] [-p palette] [-s ppem]\n";
+		exit( 1 );
+	}
+
+	font2svg::quiet = true;
+	font2svg::ttf_file file( argv[1] );
+	int palette = 0, ppem = 0;
+	std::vector<int> codepoints;
+	for ( int i = 2 ; i < argc ; i++ ) {
+		std::string a( argv[i] );
+		if (a == "-p" && i+1 < argc) palette = strtol( argv[++i], NULL, 0 );
+		else if (a == "-s" && i+1 < argc) ppem = strtol( argv[++i], NULL, 0 );
+		else codepoints.push_back( strtol( argv[i], NULL, 0 ) );
+	}
+
+	font2svg::color_font colors( file, palette, ppem );
+	for ( size_t i = 0 ; i < codepoints.size() ; i++ )
+		std::cout << colors.document( codepoints[i] );
+	std::cerr << colors.cached() << " layer outlines converted\n";
+	file.free();
+
+  return 0;
+}
@@ -0,0 +1,346 @@
+// font2svg.cpp font_to_svg - public domain
+// batch converter: many characters of one font, in one process
+
+#include "font_to_svg.hpp"
+#include "font_to_svg_arena.hpp"
+#include "font_to_svg_color.hpp"
+#include "font_to_svg_incremental.hpp"
+#include "font_to_svg_metrics.hpp"
+#include "font_to_svg_names.hpp"
+#include "font_to_svg_stroke.hpp"
+#include <filesystem>
+#include <fstream>
+#include <set>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+
+struct job
+{
+	int codepoint;
+	long gid;           // glyph id, or -1 = the glyph of 'codepoint'
+	std::string name;   // glyph name, until looked up
+	std::string output; // template from the manifest line, empty = the default
+};
+
+void usage( char * argv0 )
+{
+	std::cerr << "usage: " << argv0 << " [options] file.ttf codepoints output-template\n"
+		<< "       " << argv0 << " --metrics output.json|output.bin file.ttf\n"
+		<< "\n"
+		<< " codepoints       list and ranges, like 0x41-0x5A,97,0x2766\n"
+		<< "                  or @manifest.txt, one 'codepoints [output]' per line\n"
+		<< "                  (output as output-template; a range needs {hex},\n"
+		<< "                  {dec}, {name} or {gid} in it);\n"
+		<< "                  glyphs without a codepoint by id (g12, g12-g40) or\n"
+		<< "                  by name (/uni2766)\n"
+		<< " output-template  file name, where {hex} {dec} {name} {gid} are replaced\n"
+		<< "                  by the codepoint in hex (0042), decimal, glyph name\n"
+		<< "                  and glyph id\n"
+		<< "\n"
+		<< " -j N   worker threads (default: one per cpu)\n"
+		<< " -f     overwrite outputs that already exist (default: skip them)\n"
+		<< " -d     debug drawing (points, lines, labels) as in example1\n"
+		<< " --canonical  plain output in one fixed form, without comments: the\n"
+		<< "        same bytes for the same glyph on any machine (for hashing)\n"
+		<< " -c     color: COLR layers, or sbix / CBDT pictures, where the font\n"
+		<< "        has them (as example9)\n"
+		<< " --stroke R  outlined: the band R font units either side of the outline,\n"
+		<< "        as one filled path\n"
+		<< " --bold R    faux bold: the glyph grown by R font units, as one path\n"
+		<< " -i F   incremental: keep glyph hashes in file F, only rewrite glyphs\n"
+		<< "        that changed since the last run (existing outputs are checked\n"
+		<< "        against F instead of being skipped)\n"
+		<< " -q     no summary\n"
+		<< " --stats json|prom  print stage timings and counters to stdout at the\n"
+		<< "        end (needs a build with FONT2SVG_INSTRUMENT)\n"
+		<< " --metrics F  write advances, bearings and kerning of every glyph\n"
+		<< "        (by glyph id) to F, as JSON if F ends in .json, else binary\n";
+	exit( 1 );
+}
+
+// "0x41-0x5A,97,g3-g9,/florin" -> jobs
+void parse_list( std::string spec, std::vector<job> &jobs )
+{
+	std::stringstream ss( spec );
+	std::string item;
+	while (std::getline( ss, item, ',' )) {
+		if (item.empty()) continue;
+		job j;
+		j.codepoint = 0;
+		j.gid = -1;
+		if (item[0] == '/') {
+			j.name = item.substr( 1 );
+			jobs.push_back( j );
+			continue;
+		}
+		bool by_gid = item[0] == 'g';
+		const char *s = item.c_str() + by_gid;
+		size_t dash = item.find( '-', 1 + by_gid );
+		int first = strtol( s, NULL, 0 );
+		int last = first;
+		if (dash != std::string::npos) last = strtol( item.c_str() + dash + 1 + (item[dash+1] == 'g'), NULL, 0 );
+		for ( int c = first ; c <= last ; c++ ) {
+			if (by_gid) j.gid = c;
+			else j.codepoint = c;
+			jobs.push_back( j );
+		}
+	}
+}
+
+void parse_manifest( std::string fname, std::vector<job> &jobs )
+{
+	std::ifstream in( fname.c_str() );
+	if (!in) {
+		std::cerr << "problem loading manifest " << fname << "\n";
+		exit( 1 );
+	}
+	std::string line;
+	for ( int lineno = 1 ; std::getline( in, line ) ; lineno++ ) {
+		size_t hash = line.find( '#' );
+		if (hash != std::string::npos) line = line.substr( 0, hash );
+		std::stringstream ls( line );
+		std::string cps, output;
+		if (!(ls >> cps)) continue;
+		ls >> output;
+		size_t first = jobs.size();
+		parse_list( cps, jobs );
+		if (output.empty()) continue;
+		// one name for many glyphs would have them overwrite each other
+		if (jobs.size() - first > 1 && output.find( '{' ) == std::string::npos) {
+			std::cerr << fname << ":" << lineno << ": " << cps << " is more than one glyph,"
+				<< " its output needs {hex}, {dec}, {name} or {gid}\n";
+			exit( 1 );
+		}
+		for ( size_t i = first ; i < jobs.size() ; i++ ) jobs[i].output = output;
+	}
+}
+
+std::string replace_all( std::string s, std::string from, std::string to )
+{
+	for ( size_t pos = s.find( from ) ; pos != std::string::npos ; pos = s.find( from, pos + to.size() ) )
+		s.replace( pos, from.size(), to );
+	return s;
+}
+
+std::string output_name( std::string tmpl, int codepoint, FT_UInt gid, std::string name )
+{
+	char hex[16], dec[16];
+	snprintf( hex, sizeof hex, "%04X", codepoint );
+	snprintf( dec, sizeof dec, "%d", codepoint );
+	tmpl = replace_all( tmpl, "{hex}", hex );
+	tmpl = replace_all( tmpl, "{dec}", dec );
+	tmpl = replace_all( tmpl, "{gid}", std::to_string( gid ) );
+	return replace_all( tmpl, "{name}", name );
+}
+
+bool exists( std::string fname )
+{
+	std::ifstream f( fname.c_str() );
+	return f.good();
+}
+
+int write_metrics( std::string font, std::string fname )
+{
+	font2svg::quiet = true;
+	font2svg::ttf_file file( font );
+	font2svg::metrics_table m = font2svg::read_metrics( file );
+	file.free();
+	bool json = fname.size() > 5 && fname.substr( fname.size() - 5 ) == ".json";
+	std::string out = json ? font2svg::metrics_json( m ) : font2svg::metrics_binary( m );
+	std::ofstream f( fname.c_str(), std::ios::binary );
+	f.write( out.data(), out.size() );
+	if (!f) { std::cerr << "problem writing " << fname << "\n"; return 1; }
+	return 0;
+}
+
+int main( int argc, char * argv[] )
+{
+	int threads = 0;
+	bool force = false, debugdraw = false, color = false, canonical = false, summary = true;
+	long radius = 0;
+	font2svg::stroke_style style = font2svg::stroke_ring;
+	std::string hashfile, stats, metrics;
+	std::vector<std::string> args;
+	for ( int i = 1 ; i < argc ; i++ ) {
+		std::string a( argv[i] );
+		if (a == "-j" && i+1 < argc) threads = strtol( argv[++i], NULL, 0 );
+		else if (a == "-f") force = true;
+		else if (a == "-d") debugdraw = true;
+		else if (a == "-c") color = true;
+		else if (a == "--canonical") canonical = true;
+		else if (a == "-i" && i+1 < argc) hashfile = argv[++i];
+		else if (a == "--stats" && i+1 < argc) stats = argv[++i];
+		else if (a == "--metrics" && i+1 < argc) metrics = argv[++i];
+		else if ((a == "--stroke" || a == "--bold") && i+1 < argc) {
+			radius = strtol( argv[++i], NULL, 0 );
+			style = a == "--bold" ? font2svg::stroke_bold : font2svg::stroke_ring;
+			if (radius <= 0) usage( argv[0] );
+		}
+		else if (a == "-q") summary = false;
+		else if (a.size() > 1 && a[0] == '-') usage( argv[0] );
+		else args.push_back( a );
+	}
+	if (metrics.size() && args.size() == 1) return write_metrics( args[0], metrics );
+	if (args.size() != 3 || debugdraw + color + canonical + (radius > 0) > 1) usage( argv[0] );
+	if (stats.size() && stats != "json" && stats != "prom") usage( argv[0] );
+#ifndef FONT2SVG_INSTRUMENT
+	if (stats.size()) {
+		std::cerr << "--stats: this font2svg was built without FONT2SVG_INSTRUMENT\n";
+		return 1;
+	}
+#endif
+
+	std::vector<job> jobs;
+	if (args[1][0] == '@') parse_manifest( args[1].substr( 1 ), jobs );
+	else parse_list( args[1], jobs );
+	std::string tmpl = args[2];
+
+	if (threads <= 0) threads = std::thread::hardware_concurrency();
+	if (threads < 1) threads = 1;
+	if (threads > (int)jobs.size()) threads = std::max( (int)jobs.size(), 1 );
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	font2svg::quiet = true;
+
+	// one face per worker: FreeType faces can't be shared between threads
+	std::vector<font2svg::ttf_file> files;
+	for ( int t = 0 ; t < threads ; t++ ) files.push_back( font2svg::ttf_file( args[0] ) );
+
+	// incremental: hashes of this run, written back to the file at the end
+	bool incremental = hashfile.size();
+	font2svg::incremental_manifest previous;
+	if (incremental) previous.load( hashfile );
+	std::string options = debugdraw ? "debug" : "plain";
+	if (color) {
+		// the color tables are not part of any one glyph's hash
+		const FT_ULong tables[] = { TTAG_COLR, TTAG_CPAL, TTAG_sbix, TTAG_CBLC, TTAG_CBDT };
+		uint64_t h = font2svg::hash_bytes( "color", 5 );
+		for ( size_t i = 0 ; i < sizeof tables / sizeof tables[0] ; i++ ) {
+			std::vector<unsigned char> t = font2svg::load_table( files[0].face, tables[i] );
+			if (t.size()) h = font2svg::hash_bytes( &t[0], t.size(), h );
+		}
+		options = "color " + std::to_string( h );
+	}
+	if (canonical) options = "canonical";
+	if (radius) options = (style == font2svg::stroke_bold ? "bold " : "stroke ") + std::to_string( radius );
+	font2svg::glyph_hasher hasher( files[0], options );
+
+	/* names and codepoints of every glyph, looked up once for all workers,
+	and the output file names, so missing directories are made up front */
+	font2svg::glyph_names names( files[0] );
+	std::vector<std::string> fnames( jobs.size() );
+	std::set<std::string> dirs;
+	for ( size_t i = 0 ; i < jobs.size() ; i++ ) {
+		job &j = jobs[i];
+		if (j.name.size()) j.gid = names.gid( j.name );
+		if (j.gid >= 0 && !names.codepoints( j.gid ).empty()) j.codepoint = names.codepoints( j.gid ).first[0];
+		bool by_gid = j.name.size() || j.gid >= 0;
+		if (by_gid ? j.gid < 0 || (size_t)j.gid >= names.size() : names.glyph( j.codepoint ) == 0) continue;
+		FT_UInt glyph_index = by_gid ? j.gid : names.glyph( j.codepoint );
+		fnames[i] = output_name( j.output.size() ? j.output : tmpl, j.codepoint, glyph_index, names.name( glyph_index ) );
+		std::string dir = std::filesystem::path( fnames[i] ).parent_path().string();
+		if (dir.size()) dirs.insert( dir );
+	}
+	for ( std::set<std::string>::iterator d = dirs.begin() ; d != dirs.end() ; ++d ) {
+		std::error_code ec;
+		std::filesystem::create_directories( *d, ec );
+		if (ec) {
+			std::cerr << "problem making directory " << *d << ": " << ec.message() << "\n";
+			return 1;
+		}
+	}
+	std::vector<uint64_t> hashes( jobs.size() );
+	std::vector<std::string> written( jobs.size() );
+
+	std::atomic<size_t> next( 0 );
+	std::atomic<long> converted( 0 ), skipped( 0 ), unchanged( 0 ), missing( 0 ), failed( 0 ), bytes( 0 );
+	std::vector<std::thread> workers;
+	for ( int t = 0 ; t < threads ; t++ ) {
+		workers.push_back( std::thread( [&,t]() {
+			font2svg::ttf_file &file = files[t];
+			font2svg::arena scratch;
+			std::unique_ptr<font2svg::color_font> colors;
+			if (color) colors.reset( new font2svg::color_font( file ) );
+			std::unique_ptr<font2svg::stroker> strokes;
+			if (radius) strokes.reset( new font2svg::stroker( file ) );
+			for ( size_t i = next++ ; i < jobs.size() ; i = next++ ) {
+				int cp = jobs[i].codepoint;
+				bool by_gid = jobs[i].name.size() || jobs[i].gid >= 0;
+				const std::string &fname = fnames[i];
+				if (fname.empty()) {
+					missing++;
+					continue;
+				}
+				FT_UInt glyph_index = by_gid ? jobs[i].gid : names.glyph( cp );
+				const char *glyph_name = names.name( glyph_index );
+				// glyphs asked for by id or name are kept apart from characters
+				int key = by_gid ? font2svg::incremental_manifest::glyph_key( glyph_index ) : cp;
+				if (incremental) {
+					hashes[i] = hasher.hash( glyph_index, file.face );
+					if (!force && !previous.needs_update( key, hashes[i], fname ) && exists( fname )) {
+						written[i] = fname;
+						unchanged++;
+						continue;
+					}
+				} else if (!force && exists( fname )) { skipped++; continue; }
+
+				scratch.release();
+				font2svg::glyph g( file, cp, glyph_index, glyph_name, &scratch );
+				std::pmr::string svg( &scratch );
+				if (color)
+					svg = colors->document( cp, glyph_index ).c_str();
+				else if (canonical)
+					svg = font2svg::canonical_document( g ).c_str();
+				else if (radius)
+					svg = strokes->document( g, radius, style ).c_str();
+				else if (debugdraw)
+					svg = ( g.svgheader() + g.svgborder() + g.svgtransform() + g.axes()
+						+ g.typography_box() + g.points() + g.pointlines()
+						+ g.outline() + g.labelpts() + g.svgfooter() ).c_str();
+				else
+					svg = font2svg::document( g, &scratch );
+
+				std::ofstream out( fname.c_str(), std::ios::binary );
+				out.write( svg.data(), svg.size() );
+				if (!out) { failed++; std::cerr << "problem writing " << fname << "\n"; continue; }
+				written[i] = fname;
+				converted++;
+				bytes += svg.size();
+				FONT2SVG_COUNT( bytes, svg.size() );
+			}
+		} ) );
+	}
+	for ( size_t t = 0 ; t < workers.size() ; t++ ) workers[t].join();
+	for ( size_t t = 0 ; t < files.size() ; t++ ) files[t].free();
+
+	if (incremental) {
+		for ( size_t i = 0 ; i < jobs.size() ; i++ )
+			if (written[i].size()) {
+				bool by_gid = jobs[i].name.size() || jobs[i].gid >= 0;
+				previous.update( by_gid ? font2svg::incremental_manifest::glyph_key( jobs[i].gid )
+					: jobs[i].codepoint, hashes[i], written[i] );
+			}
+		if (!previous.save( hashfile )) { std::cerr << "problem writing " << hashfile << "\n"; failed++; }
+	}
+
+	double secs = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+	if (summary) {
+		std::cerr << converted << " converted, ";
+		if (incremental) std::cerr << unchanged << " unchanged, ";
+		else std::cerr << skipped << " skipped (exist), ";
+		std::cerr
+			<< missing << " not in font, " << failed << " failed\n"
+			<< threads << " threads, " << secs << " s, "
+			<< (secs > 0 ? converted / secs : 0) << " glyphs/s, "
+			<< (secs > 0 ? bytes / secs / 1e6 : 0) << " MB/s\n";
+	}
+
+#ifdef FONT2SVG_INSTRUMENT
+	if (stats == "json") std::cout << font2svg::stats::json();
+	if (stats == "prom") std::cout << font2svg::stats::prometheus();
+#endif
+
+	return failed ? 1 : 0;
+}
@@ -0,0 +1,323 @@
+// font2svg_fuzz.cpp font_to_svg - public domain
+// random outlines through every output policy, checked against FreeType
+//
+//   font2svg_fuzz [iterations] [seed]    random outlines
+//   font2svg_fuzz file.ttf               every glyph of a font
+//
+// For each outline:
+//  1. svg_verbose and svg_compact text, read back, and the binary path
+//     must hold exactly the same commands, and flatten_outline() must give
+//     the same commands as walk_outline()
+//  2. the walk, drawn by the raster policy, must match pixel for pixel the
+//     same outline split into pieces by FreeType (FT_Outline_Decompose)
+//  3. and must agree with FreeType's own renderer (FT_Outline_Get_Bitmap)
+//     on every pixel clearly inside or clearly outside
+//
+// Built with -DFONT2SVG_LIBFUZZER (and clang -fsanitize=fuzzer) the same
+// checks run on outlines made from libFuzzer's input instead.
+
+#include "font_to_svg.hpp"
+#include FT_OUTLINE_H
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+const int size = 64;   // bitmap width and height, pixels
+const int units = 16;  // font units per pixel; outlines fit in 0..1023
+
+struct test_outline
+{
+	std::vector<FT_Vector> points;
+	std::vector<char> tags;
+	std::vector<short> contours;
+};
+
+// xorshift, so a seed gives the same outlines everywhere
+struct rng
+{
+	uint64_t s;
+	rng( uint64_t seed ) : s( seed * 2654435761ULL + 1 ) {}
+	unsigned next() { s ^= s << 13; s ^= s >> 7; s ^= s << 17; return (unsigned)(s >> 11); }
+	int below( int n ) { return next() % n; }
+};
+
+/* 1 to 4 contours of 1 to 12 points. Points are often repeated, and
+runs of control points are common, including at the start of contours. */
+test_outline random_outline( rng &r )
+{
+	test_outline o;
+	int contours = 1 + r.below( 4 );
+	for ( int c = 0 ; c < contours ; c++ ) {
+		int n = 1 + r.below( 12 );
+		int on_odds = 1 + r.below( 4 ); // 1: all control points
+		for ( int i = 0 ; i < n ; i++ ) {
+			FT_Vector v;
+			if (i && r.below( 8 ) == 0) v = o.points.back();
+			else { v.x = r.below( size * units ); v.y = r.below( size * units ); }
+			o.points.push_back( v );
+			o.tags.push_back( r.below( on_odds ) ? FT_CURVE_TAG_ON : FT_CURVE_TAG_CONIC );
+		}
+		o.contours.push_back( o.points.size() - 1 );
+	}
+	return o;
+}
+
+// Same, with the choices read from 'data' (for libFuzzer)
+test_outline outline_from_bytes( const uint8_t *data, size_t len )
+{
+	test_outline o;
+	size_t at = 0;
+	while (at + 5 <= len && o.points.size() < 256) {
+		FT_Vector v;
+		v.x = (data[at] | (data[at+1] << 8)) % (size * units);
+		v.y = (data[at+2] | (data[at+3] << 8)) % (size * units);
+		o.points.push_back( v );
+		o.tags.push_back( (data[at+4] & 1) ? FT_CURVE_TAG_ON : FT_CURVE_TAG_CONIC );
+		if (data[at+4] & 2) o.contours.push_back( o.points.size() - 1 );
+		at += 5;
+	}
+	if (o.points.size() && (o.contours.empty() || o.contours.back() != (short)o.points.size() - 1))
+		o.contours.push_back( o.points.size() - 1 );
+	return o;
+}
+
+FT_Outline as_ft_outline( test_outline &o )
+{
+	FT_Outline f;
+	memset( &f, 0, sizeof f );
+	f.n_points = o.points.size();
+	f.n_contours = o.contours.size();
+	f.points = o.points.data();
+	f.tags = o.tags.data();
+	f.contours = o.contours.data();
+	return f;
+}
+
+// svg path text back into path_binary's form. After M, further
+// coordinate pairs are line-tos, as in the svg specification.
+std::vector<int> parse_path( const std::string &d )
+{
+	std::vector<int> out;
+	char cmd = 0;
+	const char *p = d.c_str();
+	int moved = 0;
+	for (;;) {
+		while (*p == ' ' || *p == ',' || *p == '\n') p++;
+		if (!*p) break;
+		if (isalpha( *p )) { cmd = *p++; moved = 0; if (cmd == 'Z') out.push_back( font2svg::path_binary::CLOSE ); continue; }
+		char *end;
+		long n = strtol( p, &end, 10 );
+		if (end == p) { out.push_back( -999 ); break; }
+		p = end;
+		std::vector<long> args( 1, n );
+		int want = cmd == 'Q' ? 4 : 2;
+		while ((int)args.size() < want) {
+			while (*p == ' ' || *p == ',' || *p == '\n') p++;
+			args.push_back( strtol( p, &end, 10 ) );
+			if (end == p) { out.push_back( -999 ); return out; }
+			p = end;
+		}
+		char c = (cmd == 'M' && moved++) ? 'L' : cmd;
+		out.push_back( c == 'M' ? font2svg::path_binary::MOVE : c == 'L' ? font2svg::path_binary::LINE : font2svg::path_binary::QUAD );
+		for ( size_t i = 0 ; i < args.size() ; i++ ) out.push_back( args[i] );
+	}
+	return out;
+}
+
+// FT_Outline_Decompose callbacks, into the raster policy (y flipped)
+int ft_move( const FT_Vector *to, void *user ) { ((font2svg::raster *)user)->move( to->x, -to->y ); return 0; }
+int ft_line( const FT_Vector *to, void *user ) { ((font2svg::raster *)user)->line( to->x, -to->y ); return 0; }
+int ft_conic( const FT_Vector *c, const FT_Vector *to, void *user ) { ((font2svg::raster *)user)->quad( c->x, -c->y, to->x, -to->y ); return 0; }
+int ft_cubic( const FT_Vector *, const FT_Vector *, const FT_Vector *, void * ) { return 1; }
+
+// winding numbers of the raster's edges at (x0,y), (x0+1,y) ... n points
+std::vector<int> windings( const font2svg::raster &r, double x0, double y, int n )
+{
+	std::vector< std::pair<double,int> > xs;
+	for ( size_t i = 0 ; i < r.edges.size() ; i++ ) {
+		const font2svg::raster::edge &e = r.edges[i];
+		if ((y < e.y0) == (y < e.y1)) continue;
+		double t = (y - e.y0) / (e.y1 - e.y0);
+		xs.push_back( std::make_pair( e.x0 + t*(e.x1 - e.x0), e.y1 > e.y0 ? 1 : -1 ) );
+	}
+	std::sort( xs.begin(), xs.end() );
+	std::vector<int> w( n );
+	size_t k = 0;
+	for ( int i = 0, sum = 0 ; i < n ; i++ ) {
+		while (k < xs.size() && xs[k].first <= x0 + i) sum += xs[k++].second;
+		w[i] = sum;
+	}
+	return w;
+}
+
+std::string show( const test_outline &o )
+{
+	std::stringstream tmp;
+	for ( size_t i = 0, c = 0 ; i < o.points.size() ; i++ ) {
+		tmp << o.points[i].x << "," << o.points[i].y << ((o.tags[i] & 1) ? "" : "*");
+		if (c < o.contours.size() && (int)i == o.contours[c]) { tmp << " | "; c++; } else tmp << " ";
+	}
+	return tmp.str();
+}
+
+/* All checks on one outline. Returns an empty string, or what went wrong. */
+std::string check( FT_Library library, test_outline &o )
+{
+	if (o.points.empty()) return "";
+	const FT_Vector *pts = o.points.data();
+	const char *tags = o.tags.data();
+	const short *contours = o.contours.data();
+	int nc = o.contours.size();
+
+	// 1. the text policies hold the same commands as the binary one
+	font2svg::path_binary bin;
+	font2svg::svg_verbose verbose;
+	font2svg::svg_compact compact;
+	font2svg::walk_outline( pts, tags, contours, nc, bin, true );
+	font2svg::walk_outline( pts, tags, contours, nc, verbose, true );
+	font2svg::walk_outline( pts, tags, contours, nc, compact, true );
+	if (parse_path( verbose.svg.str() ) != bin.data) return "svg_verbose differs from path_binary";
+	if (parse_path( compact.svg.str() ) != bin.data) return "svg_compact differs from path_binary: " + compact.svg.str();
+
+	// flatten_outline + play give the policies the same calls as the walk
+	for ( int flip = 0 ; flip < 2 ; flip++ ) {
+		font2svg::path_binary walked, played;
+		std::pmr::vector<font2svg::flat_op> ops;
+		font2svg::walk_outline( pts, tags, contours, nc, walked, flip );
+		font2svg::flatten_outline( pts, tags, contours, o.points.size(), nc, ops, !flip );
+		font2svg::play( ops, played, true );
+		if (played.data != walked.data) return "flatten_outline differs from walk_outline";
+	}
+
+	// 2. the walk and FreeType's decomposition draw the same thing
+	double scale = 1.0 / units;
+	font2svg::raster ours( size, size, scale, 0, size );
+	font2svg::walk_outline( pts, tags, contours, nc, ours, true );
+	ours.close();
+	ours.fill();
+	FT_Outline f = as_ft_outline( o );
+	font2svg::raster theirs( size, size, scale, 0, size );
+	FT_Outline_Funcs funcs = { ft_move, ft_line, ft_conic, ft_cubic, 0, 0 };
+	if (FT_Outline_Decompose( &f, &funcs, &theirs )) return "FT_Outline_Decompose failed";
+	theirs.close();
+	theirs.fill();
+	int differ = 0;
+	for ( int i = 0 ; i < size * size ; i++ ) differ += ours.pixels[i] != theirs.pixels[i];
+	if (differ) {
+		std::stringstream tmp;
+		tmp << differ << " pixels differ from FT_Outline_Decompose";
+		return tmp.str();
+	}
+
+	// 3. FreeType's renderer (points in 26.6 pixels)
+	test_outline scaled = o;
+	for ( size_t i = 0 ; i < scaled.points.size() ; i++ ) {
+		scaled.points[i].x = scaled.points[i].x * 64 / units;
+		scaled.points[i].y = scaled.points[i].y * 64 / units;
+	}
+	FT_Outline fs = as_ft_outline( scaled );
+	std::vector<unsigned char> gray( size * size, 0 );
+	FT_Bitmap bm;
+	memset( &bm, 0, sizeof bm );
+	bm.rows = size;
+	bm.width = size;
+	bm.pitch = size;
+	bm.buffer = gray.data();
+	bm.num_grays = 256;
+	bm.pixel_mode = FT_PIXEL_MODE_GRAY;
+	if (FT_Outline_Get_Bitmap( library, &fs, &bm )) return "FT_Outline_Get_Bitmap failed";
+	/* FreeType's coverage is the size of the signed area over the pixel, so
+	it is not the non-zero rule where windings of 2 or more, or of opposite
+	signs, meet. Only pixels whose centre and corners all have winding 0,
+	or all the same winding of 1 or -1, are compared. */
+	int wrong = 0;
+	for ( int row = 0 ; row < size ; row++ ) {
+		std::vector<int> top = windings( ours, 0, row, size + 1 );
+		std::vector<int> mid = windings( ours, 0.5, row + 0.5, size );
+		std::vector<int> bottom = windings( ours, 0, row + 1, size + 1 );
+		for ( int col = 0 ; col < size ; col++ ) {
+			int w = mid[col];
+			if (w < -1 || w > 1) continue;
+			if (top[col] != w || top[col+1] != w || bottom[col] != w || bottom[col+1] != w) continue;
+			unsigned char v = gray[ row*size + col ];
+			if ((v == 255 && w == 0) || (v == 0 && w != 0)) wrong++;
+		}
+	}
+	if (wrong) {
+		std::stringstream tmp;
+		tmp << wrong << " pixels disagree with FT_Outline_Get_Bitmap";
+		return tmp.str();
+	}
+	return "";
+}
+
+#ifdef FONT2SVG_LIBFUZZER
+
+extern "C" int LLVMFuzzerTestOneInput( const uint8_t *data, size_t len )
+{
+	static FT_Library library = NULL;
+	if (!library) FT_Init_FreeType( &library );
+	test_outline o = outline_from_bytes( data, len );
+	std::string problem = check( library, o );
+	if (problem.size()) {
+		std::cerr << problem << "\n" << show( o ) << "\n";
+		abort();
+	}
+	return 0;
+}
+
+#else
+
+int main( int argc, char * argv[] )
+{
+	FT_Library library;
+	FT_Init_FreeType( &library );
+	font2svg::quiet = true;
+	int failures = 0;
+	long tried = 0;
+
+	if (argc > 1 && !isdigit( argv[1][0] )) {
+		// every glyph of a font, scaled into the test box
+		font2svg::ttf_file file( argv[1] );
+		FT_Face face = file.face;
+		long span = std::max( face->bbox.xMax - face->bbox.xMin, face->bbox.yMax - face->bbox.yMin );
+		for ( FT_UInt gid = 0 ; gid < (FT_UInt)face->num_glyphs ; gid++ ) {
+			font2svg::glyph g( file, 0, gid, "" );
+			test_outline o;
+			for ( int i = 0 ; i < g.ftoutline.n_points ; i++ ) {
+				FT_Vector v;
+				v.x = (g.ftpoints[i].x - face->bbox.xMin) * (size * units - 1) / span;
+				v.y = (g.ftpoints[i].y - face->bbox.yMin) * (size * units - 1) / span;
+				o.points.push_back( v );
+				o.tags.push_back( g.tags[i] );
+			}
+			o.contours.assign( g.contours, g.contours + g.ftoutline.n_contours );
+			bool cubic = false;
+			for ( size_t i = 0 ; i < o.tags.size() ; i++ ) cubic |= (o.tags[i] & 3) == FT_CURVE_TAG_CUBIC;
+			if (cubic) continue; // the walker draws quadratic curves only
+			tried++;
+			std::string problem = check( library, o );
+			if (problem.size()) {
+				if (failures++ < 10) std::cerr << "glyph " << gid << ": " << problem << "\n";
+			}
+		}
+		file.free();
+	} else {
+		long iterations = argc > 1 ? atol( argv[1] ) : 10000;
+		uint64_t seed = argc > 2 ? strtoull( argv[2], NULL, 0 ) : 1;
+		for ( long i = 0 ; i < iterations ; i++ ) {
+			rng r( seed + i );
+			test_outline o = random_outline( r );
+			tried++;
+			std::string problem = check( library, o );
+			if (problem.size() && failures++ < 10)
+				std::cerr << "seed " << seed + i << ": " << problem << "\n  " << show( o ) << "\n";
+		}
+	}
+
+	FT_Done_FreeType( library );
+	std::cerr << tried << " outlines, " << failures << " failed\n";
+	return failures ? 1 : 0;
+}
+
+#endif
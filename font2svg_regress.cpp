@@ -0,0 +1,534 @@
+// font2svg_regress.cpp font_to_svg - public domain
+// output regression check: a generated font corpus, hashed and timed
+//
+//   font2svg_regress --generate dir                write the test fonts
+//   font2svg_regress [options] dir baseline.txt    convert and compare
+//
+//  -l NAME    a C locale with a decimal comma, for the printf check below
+//             (default: the first of de_DE, fr_FR, nl_NL installed)
+//  -t F       also check throughput, F being the tolerance as a fraction
+//             (0.2: more than 20% slower than the baseline fails)
+//  -n N       timed passes, the best one counts (default 5)
+//  --update   write the baseline from this run instead of checking
+//  --write D  also write every document into directory D, for diffing
+//
+// The fonts are TrueType files built here from fixed seeds, so every
+// checkout makes the same corpus without shipping font files: curves with
+// runs of control points, contours starting on a control point, repeated
+// points, very small and very large units per em, composite glyphs
+// (shifted and scaled), and empty glyphs. One font has color layers (COLR
+// and CPAL, with translucent colors).
+//
+// Every glyph goes through canonical_document(), or for the color font,
+// color_font::document(). Then:
+//  1. per font, the hash of the documents must match the baseline
+//  2. converting again with a global locale that groups digits ("1.234"),
+//     and a C locale with a decimal comma (for anything printf formats),
+//     must give the same hashes
+//  3. converting every font as one batch from an arena, a second time
+//     after release(), must take nothing more from the global allocator
+//  4. with -t, the best of the timed passes must reach the baseline's
+//     glyphs per second, less the tolerance (without it, the throughput
+//     is only reported)
+//
+// Hashes depend only on this code and on FreeType loading the glyphs (a
+// FreeType that changes how composites are scaled would change them), so
+// they match across machines. Throughput does not, which is why it is not
+// checked by default: to check it, run --update on an unchanged tree on
+// the same machine first.
+
+#include "font_to_svg.hpp"
+#include "font_to_svg_arena.hpp"
+#include "font_to_svg_color.hpp"
+#include "font_to_svg_incremental.hpp"
+#include <chrono>
+#include <clocale>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <locale>
+#include <map>
+
+// xorshift, so a seed gives the same fonts everywhere
+struct rng
+{
+	uint64_t s;
+	rng( uint64_t seed ) : s( seed * 2654435761ULL + 1 ) {}
+	unsigned next() { s ^= s << 13; s ^= s >> 7; s ^= s << 17; return (unsigned)(s >> 11); }
+	int below( int n ) { return n > 0 ? next() % n : 0; }
+	int between( int lo, int hi ) { return lo + below( hi - lo + 1 ); }
+};
+
+struct test_glyph
+{
+	std::vector<int> x, y;
+	std::vector<bool> on;
+	std::vector<int> ends;
+	struct part { int gid, dx, dy, scale; }; // scale in 2.14, 0 = none
+	std::vector<part> parts;                  // composite, if any
+	int xmin, ymin, xmax, ymax;
+	test_glyph() : xmin( 0 ), ymin( 0 ), xmax( 0 ), ymax( 0 ) {}
+};
+
+enum corpus_kind { mixed, lines, offcurve, composite, degenerate, colored };
+
+struct corpus_font
+{
+	const char *name;
+	int upem, glyphs;
+	corpus_kind kind;
+	uint64_t seed;
+};
+
+const corpus_font corpus[] = {
+	{ "mixed-1000.ttf", 1000, 300, mixed, 1 },
+	{ "mixed-2048.ttf", 2048, 300, mixed, 2 },
+	{ "lines-16.ttf", 16, 200, lines, 3 },
+	{ "offcurve-2048.ttf", 2048, 300, offcurve, 4 },
+	{ "large-16384.ttf", 16384, 200, mixed, 5 },
+	{ "composite-1000.ttf", 1000, 300, composite, 6 },
+	{ "degenerate-1000.ttf", 1000, 200, degenerate, 7 },
+	{ "color-1000.ttf", 1000, 200, colored, 8 },
+};
+const int corpus_size = sizeof corpus / sizeof corpus[0];
+
+void bounds( test_glyph &g )
+{
+	for ( size_t i = 0 ; i < g.x.size() ; i++ ) {
+		if (i == 0 || g.x[i] < g.xmin) g.xmin = g.x[i];
+		if (i == 0 || g.y[i] < g.ymin) g.ymin = g.y[i];
+		if (i == 0 || g.x[i] > g.xmax) g.xmax = g.x[i];
+		if (i == 0 || g.y[i] > g.ymax) g.ymax = g.y[i];
+	}
+}
+
+// .notdef: a box with a box cut out of it
+test_glyph notdef( int upem )
+{
+	test_glyph g;
+	int a = upem / 10, b = upem / 2, h = upem * 7 / 10, w = upem / 20 + 1;
+	int xs[] = { a, a, b, b, a+w, b-w, b-w, a+w };
+	int ys[] = { 0, h, h, 0, w, w, h-w, h-w };
+	for ( int i = 0 ; i < 8 ; i++ ) { g.x.push_back( xs[i] ); g.y.push_back( ys[i] ); g.on.push_back( true ); }
+	g.ends.push_back( 3 );
+	g.ends.push_back( 7 );
+	bounds( g );
+	return g;
+}
+
+test_glyph random_glyph( rng &r, const corpus_font &f )
+{
+	test_glyph g;
+	int lo = -f.upem / 8, hi = f.upem * 7 / 8;
+	int contours = f.kind == degenerate ? r.between( 1, 5 ) : r.between( 1, 4 );
+	for ( int c = 0 ; c < contours ; c++ ) {
+		int n = f.kind == degenerate ? r.between( 1, 4 ) : r.between( 3, 16 );
+		int on_odds = f.kind == offcurve ? 5 : 3;
+		int x0 = r.between( lo, hi ), y0 = r.between( lo, hi );
+		int span = std::max( f.upem / 4, 2 );
+		for ( int i = 0 ; i < n ; i++ ) {
+			bool repeat = i && r.below( f.kind == degenerate ? 2 : 10 ) == 0;
+			g.x.push_back( repeat ? g.x.back() : std::min( std::max( x0 + r.between( -span, span ), lo ), hi ) );
+			g.y.push_back( repeat ? g.y.back() : std::min( std::max( y0 + r.between( -span, span ), lo ), hi ) );
+			bool on = true;
+			if (f.kind == offcurve) on = r.below( on_odds ) == 0;
+			else if (f.kind != lines) on = r.below( on_odds ) != 0;
+			g.on.push_back( on );
+		}
+		g.ends.push_back( g.x.size() - 1 );
+	}
+	bounds( g );
+	return g;
+}
+
+test_glyph composite_glyph( rng &r, const corpus_font &f, const std::vector<test_glyph> &done )
+{
+	test_glyph g;
+	int parts = r.between( 1, 3 );
+	for ( int i = 0 ; i < parts ; i++ ) {
+		int gid;
+		do gid = r.between( 2, done.size() - 1 ); while (done[gid].parts.size() || done[gid].x.empty());
+		test_glyph::part p = { gid, r.between( -f.upem / 4, f.upem / 4 ), r.between( -f.upem / 4, f.upem / 4 ),
+			r.below( 3 ) ? 0 : r.between( 0x2000, 0x5000 ) };
+		g.parts.push_back( p );
+		// the parts' boxes, moved and scaled (near enough for a header)
+		const test_glyph &s = done[gid];
+		long k = p.scale ? p.scale : 0x4000;
+		int x0 = s.xmin * k / 0x4000 + p.dx, x1 = s.xmax * k / 0x4000 + p.dx;
+		int y0 = s.ymin * k / 0x4000 + p.dy, y1 = s.ymax * k / 0x4000 + p.dy;
+		if (i == 0 || x0 < g.xmin) g.xmin = x0;
+		if (i == 0 || y0 < g.ymin) g.ymin = y0;
+		if (i == 0 || x1 > g.xmax) g.xmax = x1;
+		if (i == 0 || y1 > g.ymax) g.ymax = y1;
+	}
+	return g;
+}
+
+std::vector<test_glyph> make_glyphs( const corpus_font &f )
+{
+	rng r( f.seed );
+	std::vector<test_glyph> glyphs;
+	glyphs.push_back( notdef( f.upem ) );
+	glyphs.push_back( test_glyph() ); // space: no outline at all
+	while ((int)glyphs.size() < f.glyphs) {
+		if (f.kind == degenerate && r.below( 5 ) == 0) glyphs.push_back( test_glyph() );
+		else if (f.kind == composite && glyphs.size() > 20 && r.below( 2 ))
+			glyphs.push_back( composite_glyph( r, f, glyphs ) );
+		else glyphs.push_back( random_glyph( r, f ) );
+	}
+	return glyphs;
+}
+
+// big endian
+void put16( std::string &b, int v ) { b += char( (v >> 8) & 255 ); b += char( v & 255 ); }
+void put32( std::string &b, uint32_t v ) { put16( b, v >> 16 ); put16( b, v & 0xFFFF ); }
+
+std::string glyf_entry( const test_glyph &g )
+{
+	std::string b;
+	if (g.parts.size()) {
+		put16( b, -1 );
+		put16( b, g.xmin ); put16( b, g.ymin ); put16( b, g.xmax ); put16( b, g.ymax );
+		for ( size_t i = 0 ; i < g.parts.size() ; i++ ) {
+			const test_glyph::part &p = g.parts[i];
+			// ARG_1_AND_2_ARE_WORDS | ARGS_ARE_XY_VALUES, + WE_HAVE_A_SCALE, + MORE_COMPONENTS
+			int flags = 0x0001 | 0x0002 | (p.scale ? 0x0008 : 0) | (i + 1 < g.parts.size() ? 0x0020 : 0);
+			put16( b, flags );
+			put16( b, p.gid );
+			put16( b, p.dx );
+			put16( b, p.dy );
+			if (p.scale) put16( b, p.scale );
+		}
+	} else if (g.x.size()) {
+		put16( b, g.ends.size() );
+		put16( b, g.xmin ); put16( b, g.ymin ); put16( b, g.xmax ); put16( b, g.ymax );
+		for ( size_t i = 0 ; i < g.ends.size() ; i++ ) put16( b, g.ends[i] );
+		put16( b, 0 ); // no instructions
+		for ( size_t i = 0 ; i < g.x.size() ; i++ ) b += char( g.on[i] ? 1 : 0 );
+		// every coordinate as a 16 bit difference from the one before
+		for ( size_t i = 0 ; i < g.x.size() ; i++ ) put16( b, g.x[i] - (i ? g.x[i-1] : 0) );
+		for ( size_t i = 0 ; i < g.y.size() ; i++ ) put16( b, g.y[i] - (i ? g.y[i-1] : 0) );
+	}
+	while (b.size() % 4) b += char( 0 );
+	return b;
+}
+
+uint32_t checksum( const std::string &t )
+{
+	uint32_t sum = 0;
+	for ( size_t i = 0 ; i < t.size() ; i += 4 )
+		for ( int k = 0 ; k < 4 ; k++ )
+			sum += (i + k < t.size() ? (unsigned char)t[i+k] : 0) << (24 - 8*k);
+	return sum;
+}
+
+/* COLR (version 0) and CPAL: every third glyph of the second half is
+drawn as 1 to 3 layers, glyphs of the first half, each in a palette color
+or the text color (0xFFFF). Some colors are translucent. */
+void add_color( std::map<std::string, std::string> &tables, int n, uint64_t seed )
+{
+	rng r( seed + 1000 );
+	const unsigned char bgra[][4] = { { 0, 0, 255, 255 }, { 0, 160, 0, 128 },
+		{ 200, 30, 30, 64 }, { 10, 200, 220, 1 }, { 90, 90, 90, 254 } };
+	const int n_colors = sizeof bgra / sizeof bgra[0];
+	std::string bases, layers;
+	int n_bases = 0, n_layers = 0;
+	for ( int gid = n / 2 ; gid < n ; gid += 3 ) {
+		int count = r.between( 1, 3 );
+		put16( bases, gid ); put16( bases, n_layers ); put16( bases, count );
+		for ( int k = 0 ; k < count ; k++ ) {
+			put16( layers, r.between( 2, n / 2 - 1 ) );
+			put16( layers, r.below( 4 ) ? r.below( n_colors ) : 0xFFFF );
+		}
+		n_bases++;
+		n_layers += count;
+	}
+	std::string &colr = tables["COLR"];
+	put16( colr, 0 ); put16( colr, n_bases );
+	put32( colr, 14 ); put32( colr, 14 + bases.size() ); put16( colr, n_layers );
+	colr += bases + layers;
+	std::string &cpal = tables["CPAL"];
+	put16( cpal, 0 ); put16( cpal, n_colors ); put16( cpal, 1 ); put16( cpal, n_colors );
+	put32( cpal, 14 ); put16( cpal, 0 );
+	for ( int i = 0 ; i < n_colors ; i++ ) cpal.append( (const char *)bgra[i], 4 );
+}
+
+/* The smallest TrueType file FreeType reads: head, hhea, maxp, hmtx, cmap
+(format 12: glyph 1 on is U+0020, 2 is U+0021...), loca and glyf. No
+dates, so the file only depends on the glyphs. */
+std::string make_font( const corpus_font &f )
+{
+	std::vector<test_glyph> glyphs = make_glyphs( f );
+	int n = glyphs.size();
+	std::string glyf, loca, hmtx;
+	int xmin = 0, ymin = 0, xmax = 0, ymax = 0, max_advance = 0;
+	int max_points = 0, max_contours = 0, max_parts = 0;
+	for ( int i = 0 ; i < n ; i++ ) {
+		const test_glyph &g = glyphs[i];
+		put32( loca, glyf.size() );
+		glyf += glyf_entry( g );
+		xmin = std::min( xmin, g.xmin ); ymin = std::min( ymin, g.ymin );
+		xmax = std::max( xmax, g.xmax ); ymax = std::max( ymax, g.ymax );
+		int advance = std::max( g.xmax, 0 ) + f.upem / 10;
+		max_advance = std::max( max_advance, advance );
+		put16( hmtx, advance );
+		put16( hmtx, g.xmin );
+		max_points = std::max( max_points, (int)g.x.size() );
+		max_contours = std::max( max_contours, (int)g.ends.size() );
+		max_parts = std::max( max_parts, (int)g.parts.size() );
+	}
+	put32( loca, glyf.size() );
+
+	std::map<std::string, std::string> tables; // sorted by tag, as required
+	std::string &head = tables["head"];
+	put32( head, 0x00010000 ); put32( head, 0x00010000 ); // version, revision
+	put32( head, 0 ); put32( head, 0x5F0F3CF5 );          // checksum adjustment, magic
+	put16( head, 3 ); put16( head, f.upem );              // flags, units per em
+	for ( int i = 0 ; i < 4 ; i++ ) put32( head, 0 );     // created, modified
+	put16( head, xmin ); put16( head, ymin ); put16( head, xmax ); put16( head, ymax );
+	put16( head, 0 ); put16( head, 8 ); put16( head, 2 ); // style, smallest ppem, direction
+	put16( head, 1 ); put16( head, 0 );                   // long loca, glyf format
+	std::string &hhea = tables["hhea"];
+	put32( hhea, 0x00010000 );
+	put16( hhea, f.upem * 8 / 10 ); put16( hhea, -f.upem * 2 / 10 ); put16( hhea, 0 );
+	put16( hhea, max_advance ); put16( hhea, xmin ); put16( hhea, 0 ); put16( hhea, xmax );
+	put16( hhea, 1 ); put16( hhea, 0 ); put16( hhea, 0 );  // caret
+	for ( int i = 0 ; i < 5 ; i++ ) put16( hhea, 0 );       // reserved, metric format
+	put16( hhea, n );
+	std::string &maxp = tables["maxp"];
+	put32( maxp, 0x00010000 ); put16( maxp, n );
+	put16( maxp, max_points ); put16( maxp, max_contours );
+	put16( maxp, max_points * 3 ); put16( maxp, max_contours * 3 ); // composites, at most 3 parts
+	put16( maxp, 2 );                                   // zones
+	for ( int i = 0 ; i < 6 ; i++ ) put16( maxp, 0 );   // twilight ... instruction size
+	put16( maxp, max_parts ); put16( maxp, max_parts ? 1 : 0 );
+	tables["hmtx"] = hmtx;
+	std::string &cmap = tables["cmap"];
+	put16( cmap, 0 ); put16( cmap, 1 );                 // version, one subtable
+	put16( cmap, 3 ); put16( cmap, 10 ); put32( cmap, 12 ); // windows, ucs-4, at 12
+	put16( cmap, 12 ); put16( cmap, 0 ); put32( cmap, 16 + 12 ); put32( cmap, 0 ); put32( cmap, 1 );
+	put32( cmap, 0x20 ); put32( cmap, 0x20 + n - 2 ); put32( cmap, 1 );
+	tables["loca"] = loca;
+	tables["glyf"] = glyf;
+	if (f.kind == colored) add_color( tables, n, f.seed );
+
+	std::string file;
+	int count = tables.size(), pow2 = 1, log2 = 0;
+	while (pow2 * 2 <= count) { pow2 *= 2; log2++; }
+	put32( file, 0x00010000 ); put16( file, count );
+	put16( file, pow2 * 16 ); put16( file, log2 ); put16( file, count * 16 - pow2 * 16 );
+	size_t at = 12 + 16 * count;
+	std::string data;
+	for ( std::map<std::string, std::string>::iterator it = tables.begin() ; it != tables.end() ; ++it ) {
+		file += it->first;
+		put32( file, checksum( it->second ) );
+		put32( file, at + data.size() );
+		put32( file, it->second.size() );
+		data += it->second;
+		while (data.size() % 4) data += char( 0 );
+	}
+	return file + data;
+}
+
+int generate( std::string dir )
+{
+	for ( int i = 0 ; i < corpus_size ; i++ ) {
+		std::string fname = dir + "/" + corpus[i].name;
+		std::string font = make_font( corpus[i] );
+		std::ofstream out( fname.c_str(), std::ios::binary );
+		out.write( font.data(), font.size() );
+		if (!out) { std::cerr << "problem writing " << fname << "\n"; return 1; }
+	}
+	return 0;
+}
+
+// Numbers grouped in threes with '.', as many real locales write them
+struct grouping : std::numpunct<char>
+{
+	char do_thousands_sep() const { return '.'; }
+	std::string do_grouping() const { return "\3"; }
+	char do_decimal_point() const { return ','; }
+};
+
+struct font_result
+{
+	std::string name;
+	long glyphs;
+	uint64_t hash;
+};
+
+// Every glyph of every font through canonical_document(), hashed per font
+std::vector<font_result> convert( std::vector<font2svg::ttf_file> &files, std::string write_dir )
+{
+	std::vector<font_result> results;
+	for ( size_t i = 0 ; i < files.size() ; i++ ) {
+		font_result r = { corpus[i].name, files[i].face->num_glyphs, font2svg::hash_bytes( "", 0 ) };
+		std::unique_ptr<font2svg::color_font> colors;
+		if (corpus[i].kind == colored) colors.reset( new font2svg::color_font( files[i] ) );
+		for ( long gid = 0 ; gid < r.glyphs ; gid++ ) {
+			std::string svg;
+			if (colors) {
+				svg = colors->document( 0, gid );
+			} else {
+				font2svg::glyph g( files[i], 0, gid, "" );
+				svg = font2svg::canonical_document( g );
+			}
+			r.hash = font2svg::hash_bytes( svg.data(), svg.size(), r.hash );
+			if (write_dir.size()) {
+				std::string fname = write_dir + "/" + r.name + "-" + std::to_string( gid ) + ".svg";
+				std::ofstream out( fname.c_str(), std::ios::binary );
+				out.write( svg.data(), svg.size() );
+			}
+		}
+		results.push_back( r );
+	}
+	return results;
+}
+
+std::string hex( uint64_t h )
+{
+	char buf[24];
+	snprintf( buf, sizeof buf, "%016llx", (unsigned long long)h );
+	return buf;
+}
+
+void usage( char *argv0 )
+{
+	std::cerr << "usage: " << argv0 << " --generate dir\n"
+		<< "       " << argv0 << " [-l locale] [-t tolerance] [-n passes] [--update] [--write dir] dir baseline.txt\n";
+	exit( 1 );
+}
+
+int main( int argc, char * argv[] )
+{
+	double tolerance = -1; // throughput not checked
+	int passes = 5;
+	bool update = false;
+	std::string write_dir, comma_locale;
+	std::vector<std::string> args;
+	for ( int i = 1 ; i < argc ; i++ ) {
+		std::string a( argv[i] );
+		if (a == "--generate" && i+1 < argc) return generate( argv[++i] );
+		else if (a == "-t" && i+1 < argc) tolerance = strtod( argv[++i], NULL );
+		else if (a == "-n" && i+1 < argc) passes = std::max( (int)strtol( argv[++i], NULL, 0 ), 1 );
+		else if (a == "--update") update = true;
+		else if (a == "-l" && i+1 < argc) comma_locale = argv[++i];
+		else if (a == "--write" && i+1 < argc) write_dir = argv[++i];
+		else if (a.size() > 1 && a[0] == '-') usage( argv[0] );
+		else args.push_back( a );
+	}
+	if (args.size() != 2) usage( argv[0] );
+
+	font2svg::quiet = true;
+	std::vector<font2svg::ttf_file> files;
+	for ( int i = 0 ; i < corpus_size ; i++ )
+		files.push_back( font2svg::ttf_file( args[0] + "/" + corpus[i].name ) );
+
+	std::vector<font_result> results = convert( files, write_dir );
+	int failures = 0;
+
+	// the same again, in locales that would change any number they touched:
+	// streams follow the C++ global locale, printf the C one
+	std::locale::global( std::locale( std::locale::classic(), new grouping ) );
+	std::stringstream probe;
+	probe << 1234567;
+	const char *commas[] = { comma_locale.c_str(), "de_DE.UTF-8", "de_DE.utf8", "de_DE",
+		"fr_FR.UTF-8", "fr_FR.utf8", "fr_FR", "nl_NL.UTF-8", "nl_NL.utf8", "nl_NL" };
+	bool comma = false;
+	// -l first, if given
+	for ( size_t i = comma_locale.empty() ; i < sizeof commas / sizeof commas[0] && !comma ; i++ )
+		comma = setlocale( LC_NUMERIC, commas[i] ) != NULL;
+	char cprobe[16];
+	snprintf( cprobe, sizeof cprobe, "%.1f", 0.5 );
+	std::vector<font_result> localized = convert( files, "" );
+	setlocale( LC_NUMERIC, "C" );
+	std::locale::global( std::locale::classic() );
+	if (probe.str() == "1234567") std::cerr << "warning: the grouping locale had no effect\n";
+	if (!comma || std::string( cprobe ) == "0.5")
+		std::cerr << "warning: no C locale with a decimal comma (give one with -l), printf output not checked\n";
+	for ( size_t i = 0 ; i < results.size() ; i++ ) {
+		if (localized[i].hash != results[i].hash) {
+			std::cerr << results[i].name << ": output changes with the global locale\n";
+			failures++;
+		}
+	}
+
+	// steady state: a batch the arena has seen before allocates nothing
+	font2svg::arena scratch;
+	long upstream = 0;
+	for ( int pass = 0 ; pass < 2 ; pass++ ) {
+		size_t before = scratch.upstream_allocations();
+		for ( size_t i = 0 ; i < files.size() ; i++ ) {
+			std::vector<int> codepoints;
+			for ( long gid = 1 ; gid < files[i].face->num_glyphs ; gid++ ) codepoints.push_back( 0x1F + gid );
+			font2svg::convert_batch( files[i], codepoints, &scratch );
+		}
+		upstream = scratch.upstream_allocations() - before;
+		scratch.release();
+	}
+	std::cout << "arena: " << upstream << " upstream allocations converting again";
+	if (upstream) {
+		std::cout << " ALLOCATES in steady state";
+		failures++;
+	}
+	std::cout << "\n";
+
+	double best = 0;
+	long total = 0;
+	for ( size_t i = 0 ; i < results.size() ; i++ ) total += results[i].glyphs;
+	for ( int p = 0 ; p < passes ; p++ ) {
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		convert( files, "" );
+		double secs = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+		if (secs > 0) best = std::max( best, total / secs );
+	}
+	for ( size_t i = 0 ; i < files.size() ; i++ ) files[i].free();
+
+	if (update) {
+		std::ofstream out( args[1].c_str() );
+		out.imbue( std::locale::classic() );
+		out << "# font2svg_regress baseline: font, glyphs, hash of the canonical documents\n";
+		for ( size_t i = 0 ; i < results.size() ; i++ )
+			out << results[i].name << " " << results[i].glyphs << " " << hex( results[i].hash ) << "\n";
+		out << "# glyphs per second, best of " << passes << " passes (depends on the machine, checked only with -t)\n";
+		out << "throughput " << (long)best << "\n";
+		if (!out) { std::cerr << "problem writing " << args[1] << "\n"; return 1; }
+		std::cout << "wrote " << args[1] << ": " << results.size() << " fonts, "
+			<< total << " glyphs, " << (long)best << " glyphs/s\n";
+		return failures ? 1 : 0;
+	}
+
+	std::ifstream in( args[1].c_str() );
+	if (!in) { std::cerr << "problem loading baseline " << args[1] << "\n"; return 1; }
+	std::map<std::string, std::pair<long, std::string> > baseline;
+	double expected = 0;
+	std::string line;
+	while (std::getline( in, line )) {
+		std::stringstream ls( line );
+		std::string name, hash;
+		long glyphs;
+		if (line.empty() || line[0] == '#' || !(ls >> name)) continue;
+		if (name == "throughput") ls >> expected;
+		else if (ls >> glyphs >> hash) baseline[name] = std::make_pair( glyphs, hash );
+	}
+
+	for ( size_t i = 0 ; i < results.size() ; i++ ) {
+		const font_result &r = results[i];
+		std::string status = "ok";
+		if (!baseline.count( r.name )) status = "NOT IN BASELINE";
+		else if (baseline[r.name].first != r.glyphs || baseline[r.name].second != hex( r.hash ))
+			status = "CHANGED (was " + baseline[r.name].second + ")";
+		if (status != "ok") failures++;
+		std::cout << r.name << " " << r.glyphs << " " << hex( r.hash ) << " " << status << "\n";
+	}
+	std::cout << "throughput " << (long)best << " glyphs/s";
+	if (expected > 0) {
+		std::cout << ", baseline " << (long)expected << " (" << (long)( 100 * (best / expected - 1) ) << "%)";
+		if (tolerance >= 0 && best < expected * (1 - tolerance)) {
+			std::cout << " SLOWER than the " << (long)( 100 * tolerance ) << "% tolerance";
+			failures++;
+		}
+	}
+	std::cout << "\n" << (failures ? "FAILED" : "passed") << "\n";
+	return failures ? 1 : 0;
+}
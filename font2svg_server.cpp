@@ -0,0 +1,372 @@
+// font2svg_server.cpp font_to_svg - public domain
+// conversion server on a unix domain socket, keeps fonts and outputs warm
+//
+// protocol, one request per line, any number of requests in flight:
+//
+//   <font file> <codepoint> [plain|debug|canonical]
+//                                           ->  OK <length>\n<svg>
+//   STATS                                   ->  OK <length>\n<json>
+//   METRICS                                 ->  OK <length>\n<prometheus text>
+//                                               (FONT2SVG_INSTRUMENT builds)
+//   QUIT                                    ->  connection closed
+//
+// errors come back as 'ERR <message>\n'. Responses are in request order.
+//
+// The most recently used fonts (64 by default) are kept open; opening
+// another one closes the least recently used.
+
+#include "font_to_svg.hpp"
+#include <map>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+#include <csignal>
+#include <cstring>
+#include <cerrno>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+/* a font loaded once and kept open; one thread at a time uses the face.
+It is closed when it has been evicted and the last request using it is
+done with it. */
+struct warm_font
+{
+	font2svg::ttf_file file;
+	std::mutex lock;
+	~warm_font() { file.free(); }
+};
+
+class server
+{
+public:
+	size_t cache_limit, font_limit;
+
+	server() : cache_limit( 20000 ), font_limit( 64 ), hits( 0 ), misses( 0 ), requests( 0 ) {}
+
+	std::string convert( std::string font, int codepoint, std::string mode, bool &ok )
+	{
+		if (mode != "plain" && mode != "debug" && mode != "canonical") {
+			ok = false;
+			return "unknown mode";
+		}
+		std::string key = font + "\n" + mode + "\n" + std::to_string( codepoint );
+		{
+			std::lock_guard<std::mutex> g( cache_lock );
+			std::map<std::string, std::list<entry>::iterator>::iterator it = index.find( key );
+			if (it != index.end()) {
+				lru.splice( lru.begin(), lru, it->second );
+				hits++;
+				FONT2SVG_COUNT( cache_hits, 1 );
+				ok = true;
+				return it->second->svg;
+			}
+			misses++;
+			FONT2SVG_COUNT( cache_misses, 1 );
+		}
+
+		std::shared_ptr<warm_font> wf = open_font( font );
+		if (!wf) { ok = false; return "can not open font " + font; }
+		std::string svg;
+		{
+			std::lock_guard<std::mutex> held( wf->lock );
+			FT_UInt glyph_index = FT_Get_Char_Index( wf->file.face, codepoint );
+			if (glyph_index == 0) { ok = false; return "codepoint not in font"; }
+			char glyph_name[1024] = "";
+			if (mode == "debug") FT_Get_Glyph_Name( wf->file.face, glyph_index, glyph_name, sizeof glyph_name );
+			font2svg::glyph g( wf->file, codepoint, glyph_index, glyph_name );
+			if (mode == "debug")
+				svg = g.svgheader() + g.svgborder() + g.svgtransform() + g.axes()
+					+ g.typography_box() + g.points() + g.pointlines()
+					+ g.outline() + g.labelpts() + g.svgfooter();
+			else if (mode == "canonical")
+				svg = font2svg::canonical_document( g );
+			else
+				svg = g.svgheader() + g.svgtransform() + g.outline() + g.svgfooter();
+		}
+
+		std::lock_guard<std::mutex> g( cache_lock );
+		if (!index.count( key )) {
+			entry e;
+			e.key = key;
+			e.svg = svg;
+			lru.push_front( e );
+			index[key] = lru.begin();
+			while (lru.size() > cache_limit) {
+				index.erase( lru.back().key );
+				lru.pop_back();
+			}
+		}
+		ok = true;
+		return svg;
+	}
+
+	void record( double micros )
+	{
+		std::lock_guard<std::mutex> g( stats_lock );
+		requests++;
+		if (latencies.size() < 100000) latencies.push_back( micros );
+		else latencies[ requests % latencies.size() ] = micros;
+	}
+
+	std::string stats()
+	{
+		std::vector<double> l;
+		long n;
+		{
+			std::lock_guard<std::mutex> g( stats_lock );
+			l = latencies;
+			n = requests;
+		}
+		std::sort( l.begin(), l.end() );
+		double p50 = l.size() ? l[ l.size()*50/100 ] : 0;
+		double p99 = l.size() ? l[ std::min( l.size()-1, l.size()*99/100 ) ] : 0;
+		size_t open_fonts;
+		{
+			std::lock_guard<std::mutex> g( fonts_lock );
+			open_fonts = fonts.size();
+		}
+		std::lock_guard<std::mutex> g( cache_lock );
+		font2svg::text_stream tmp;
+		tmp << "{\"requests\": " << n
+			<< ", \"p50_us\": " << p50
+			<< ", \"p99_us\": " << p99
+			<< ", \"cache_hits\": " << hits
+			<< ", \"cache_misses\": " << misses
+			<< ", \"cached\": " << lru.size()
+			<< ", \"fonts\": " << open_fonts;
+#ifdef FONT2SVG_INSTRUMENT
+		std::string instrument = font2svg::stats::json();
+		instrument.erase( instrument.size() - 1 ); // its newline
+		tmp << ", \"instrument\": " << instrument;
+#endif
+		tmp << "}\n";
+		return tmp.str();
+	}
+
+	void serve( int fd )
+	{
+		std::string buf;
+		char chunk[4096];
+		for (;;) {
+			size_t nl;
+			while ((nl = buf.find( '\n' )) == std::string::npos) {
+				ssize_t n = read( fd, chunk, sizeof chunk );
+				if (n <= 0) { close( fd ); return; }
+				buf.append( chunk, n );
+			}
+			std::string line = buf.substr( 0, nl );
+			buf.erase( 0, nl + 1 );
+			if (line.size() && line[line.size()-1] == '\r') line.erase( line.size()-1 );
+
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			std::stringstream ls( line );
+			std::string font, cps, mode;
+			ls >> font >> cps >> mode;
+			std::string reply;
+			if (font == "QUIT") { close( fd ); return; }
+			if (font == "STATS") {
+				reply = ok_reply( stats() );
+			} else if (font == "METRICS") {
+#ifdef FONT2SVG_INSTRUMENT
+				reply = ok_reply( font2svg::stats::prometheus() );
+#else
+				reply = "ERR built without FONT2SVG_INSTRUMENT\n";
+#endif
+			} else if (font.empty() || cps.empty()) {
+				reply = "ERR expected: font codepoint [plain|debug|canonical]\n";
+			} else {
+				if (mode.empty()) mode = "plain";
+				bool ok;
+				std::string svg = convert( font, strtol( cps.c_str(), NULL, 0 ), mode, ok );
+				reply = ok ? ok_reply( svg ) : "ERR " + svg + "\n";
+				if (ok) FONT2SVG_COUNT( bytes, svg.size() );
+				record( std::chrono::duration<double, std::micro>(
+					std::chrono::steady_clock::now() - start ).count() );
+			}
+			if (!write_all( fd, reply )) { close( fd ); return; }
+		}
+	}
+
+	static bool write_all( int fd, const std::string &s )
+	{
+		size_t done = 0;
+		while (done < s.size()) {
+			ssize_t n = write( fd, s.data() + done, s.size() - done );
+			if (n <= 0) return false;
+			done += n;
+		}
+		return true;
+	}
+
+private:
+	struct entry
+	{
+		std::string key;
+		std::string svg;
+	};
+	std::list<entry> lru;
+	std::map<std::string, std::list<entry>::iterator> index;
+	// open fonts, most recently used first
+	typedef std::pair< std::string, std::shared_ptr<warm_font> > open_font_entry;
+	std::list<open_font_entry> font_lru;
+	std::map<std::string, std::list<open_font_entry>::iterator> fonts;
+	std::mutex cache_lock, fonts_lock, stats_lock;
+	long hits, misses, requests;
+	std::vector<double> latencies;
+
+	static std::string ok_reply( const std::string &body )
+	{
+		return "OK " + std::to_string( body.size() ) + "\n" + body;
+	}
+
+	std::shared_ptr<warm_font> open_font( const std::string &font )
+	{
+		{
+			std::lock_guard<std::mutex> g( fonts_lock );
+			std::map<std::string, std::list<open_font_entry>::iterator>::iterator it = fonts.find( font );
+			if (it != fonts.end()) {
+				font_lru.splice( font_lru.begin(), font_lru, it->second );
+				return it->second->second;
+			}
+		}
+		// opened here rather than by ttf_file( font ), which exits on a bad
+		// font; outside the lock, so a slow file does not hold up the others
+		FT_Library library;
+		FT_Face face;
+		FT_Init_FreeType( &library );
+		FT_Error error;
+		{
+			FONT2SVG_TIME( face_open );
+			error = FT_New_Face( library, font.c_str(), 0, &face );
+		}
+		if (error) {
+			FT_Done_FreeType( library );
+			return std::shared_ptr<warm_font>();
+		}
+		std::shared_ptr<warm_font> wf( new warm_font );
+		wf->file.filename = font;
+		wf->file.library = library;
+		wf->file.face = face;
+		wf->file.error = error;
+
+		std::lock_guard<std::mutex> g( fonts_lock );
+		std::map<std::string, std::list<open_font_entry>::iterator>::iterator it = fonts.find( font );
+		if (it != fonts.end()) {
+			// another request opened it meanwhile; ours is closed on return
+			font_lru.splice( font_lru.begin(), font_lru, it->second );
+			return it->second->second;
+		}
+		font_lru.push_front( open_font_entry( font, wf ) );
+		fonts[font] = font_lru.begin();
+		while (font_lru.size() > font_limit) {
+			fonts.erase( font_lru.back().first );
+			font_lru.pop_back();
+		}
+		return wf;
+	}
+};
+
+int listen_on( std::string path )
+{
+	int fd = socket( AF_UNIX, SOCK_STREAM, 0 );
+	struct sockaddr_un addr;
+	memset( &addr, 0, sizeof addr );
+	addr.sun_family = AF_UNIX;
+	strncpy( addr.sun_path, path.c_str(), sizeof addr.sun_path - 1 );
+	unlink( path.c_str() );
+	if (fd < 0 || bind( fd, (struct sockaddr *)&addr, sizeof addr ) || listen( fd, 64 )) {
+		std::cerr << "problem listening on " << path << ": " << strerror( errno ) << "\n";
+		exit( 1 );
+	}
+	return fd;
+}
+
+int connect_to( std::string path )
+{
+	int fd = socket( AF_UNIX, SOCK_STREAM, 0 );
+	struct sockaddr_un addr;
+	memset( &addr, 0, sizeof addr );
+	addr.sun_family = AF_UNIX;
+	strncpy( addr.sun_path, path.c_str(), sizeof addr.sun_path - 1 );
+	if (fd < 0 || connect( fd, (struct sockaddr *)&addr, sizeof addr )) {
+		std::cerr << "problem connecting to " << path << ": " << strerror( errno ) << "\n";
+		exit( 1 );
+	}
+	return fd;
+}
+
+/* Test client: send every request at once (pipelined, from a second
+thread) while reading the replies, print the svgs, then the stats. */
+int client( std::string path, std::string font, std::string range, int repeat )
+{
+	int first = strtol( range.c_str(), NULL, 0 ), last = first;
+	size_t dash = range.find( '-', 1 );
+	if (dash != std::string::npos) last = strtol( range.c_str() + dash + 1, NULL, 0 );
+	int fd = connect_to( path );
+
+	std::string requests;
+	for ( int r = 0 ; r < repeat ; r++ )
+		for ( int c = first ; c <= last ; c++ )
+			requests += font + " " + std::to_string( c ) + "\n";
+	requests += "STATS\nQUIT\n";
+	std::thread writer( [&]() { server::write_all( fd, requests ); } );
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	std::string buf;
+	char chunk[65536];
+	long replies = 0, errors = 0, expected = (long)repeat * (last - first + 1) + 1;
+	std::string last_body;
+	while (replies < expected) {
+		size_t nl = buf.find( '\n' );
+		if (nl != std::string::npos && buf.compare( 0, 3, "OK " ) == 0) {
+			size_t len = strtoul( buf.c_str() + 3, NULL, 10 );
+			if (buf.size() >= nl + 1 + len) {
+				last_body = buf.substr( nl + 1, len );
+				buf.erase( 0, nl + 1 + len );
+				if (++replies < expected) std::cout << last_body;
+				continue;
+			}
+		} else if (nl != std::string::npos) {
+			std::cerr << buf.substr( 0, nl + 1 );
+			buf.erase( 0, nl + 1 );
+			replies++;
+			errors++;
+			continue;
+		}
+		ssize_t n = read( fd, chunk, sizeof chunk );
+		if (n <= 0) break;
+		buf.append( chunk, n );
+	}
+	double secs = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+	writer.join();
+	close( fd );
+	std::cerr << replies - 1 << " replies (" << errors << " errors) in " << secs << " s\n"
+		<< "server stats: " << last_body;
+	return errors ? 1 : 0;
+}
+
+int main( int argc, char * argv[] )
+{
+	if (argc >= 3 && std::string(argv[1]) == "serve") {
+		signal( SIGPIPE, SIG_IGN );
+		font2svg::quiet = true;
+		server s;
+		int lfd = listen_on( argv[2] );
+		std::cerr << "listening on " << argv[2] << "\n";
+		for (;;) {
+			int fd = accept( lfd, NULL, NULL );
+			if (fd < 0) continue;
+			std::thread( [&s, fd]() { s.serve( fd ); } ).detach();
+		}
+	}
+	if (argc >= 5 && std::string(argv[1]) == "client")
+		return client( argv[2], argv[3], argv[4], argc > 5 ? atoi( argv[5] ) : 1 );
+
+	std::cerr << "usage: " << argv[0] << " serve /tmp/font2svg.sock\n"
+		<< "       " << argv[0] << " client /tmp/font2svg.sock file.ttf 0x41-0x5A [repeat]\n";
+	return 1;
+}
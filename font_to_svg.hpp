@@ -45,16 +45,46 @@ endorsement.
 
 #include <ft2build.h>
 #include FT_FREETYPE_H
+#include FT_MULTIPLE_MASTERS_H
+#include FT_TRUETYPE_TABLES_H
+#include FT_TRUETYPE_TAGS_H
 #include <iostream>
+#include <locale>
 #include <sstream>
 #include <vector>
 #include <string>
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include "font_to_svg_stats.hpp"
+
+// SSE2 for the outline preparation kernel; -DFONT2SVG_NO_SIMD turns it off
+#if !defined(FONT2SVG_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define FONT2SVG_SSE2 1
+#include <emmintrin.h>
+#endif
 
 namespace font2svg {
 
-std::stringstream debug;
+/* Text output is built in these: always in the "C" locale, whatever the
+program's global locale, so numbers are never grouped ("1.234") or
+written with other digits. */
+struct text_stream : std::stringstream
+{
+	text_stream() { imbue( std::locale::classic() ); }
+};
+
+// 'inline' variables and functions (C++17) keep the header safe to include
+// from any number of translation units
+inline text_stream debug;
+
+/* set to stop glyph and do_outline from printing debug info to std::cout,
+and ttf_file from adding to 'debug' (which otherwise grows with every font
+opened, and is not safe to write from more than one thread) */
+inline bool quiet = false;
 
-FT_Vector halfway_between( FT_Vector p1, FT_Vector p2 )
+inline FT_Vector halfway_between( FT_Vector p1, FT_Vector p2 )
 {
 	FT_Vector newv;
 	newv.x = p1.x + (p2.x-p1.x)/2.0;
@@ -62,6 +92,29 @@ FT_Vector halfway_between( FT_Vector p1, FT_Vector p2 )
 	return newv;
 }
 
+// A whole sfnt table, or an empty vector if the font doesn't have it.
+inline std::vector<unsigned char> load_table( FT_Face face, FT_ULong tag )
+{
+	std::vector<unsigned char> t;
+	FT_ULong len = 0;
+	if (FT_Load_Sfnt_Table( face, tag, 0, NULL, &len ) || len == 0) return t;
+	t.resize( len );
+	if (FT_Load_Sfnt_Table( face, tag, 0, &t[0], &len )) t.clear();
+	return t;
+}
+
+// big endian numbers, as stored in sfnt tables
+inline unsigned read_u16( const unsigned char *p ) { return (p[0] << 8) | p[1]; }
+inline uint32_t read_u32( const unsigned char *p ) { return ((uint32_t)p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3]; }
+
+// One design axis of a variable font (weight, width, ...)
+struct var_axis
+{
+	std::string tag;
+	std::string name;
+	double minimum, def, maximum;
+};
+
 class ttf_file
 {
 public:
@@ -75,32 +128,122 @@ public:
 		filename = std::string("");
 	}
 
-	ttf_file( std::string fname )
+	// face_index picks one face out of a .ttc/.otc collection
+	ttf_file( std::string fname, int face_index = 0 )
 	{
 		filename = fname;
 		error = FT_Init_FreeType( &library );
-		debug << "Init error code: " << error;
 
 		// Load a typeface
-		error = FT_New_Face( library, filename.c_str(), 0, &face );
-		debug << "\nFace load error code: " << error;
-		debug << "\nfont filename: " << filename;
+		{
+			FONT2SVG_TIME( face_open );
+			error = FT_New_Face( library, filename.c_str(), face_index, &face );
+		}
+		if (!quiet) {
+			debug << "Init error code: " << error;
+			debug << "\nFace load error code: " << error;
+			debug << "\nfont filename: " << filename;
+		}
 		if (error) {
 			std::cerr << "problem loading file " << filename << "\n";
 			exit(1);
 		}
+		print_face();
+	}
+
+	/* Face from a font file that is already in memory. FreeType reads the
+	bytes in place, so they must stay around until free(). */
+	ttf_file( const unsigned char *data, size_t size, int face_index, std::string fname )
+	{
+		filename = fname;
+		error = FT_Init_FreeType( &library );
+
+		{
+			FONT2SVG_TIME( face_open );
+			error = FT_New_Memory_Face( library, data, size, face_index, &face );
+		}
+		if (!quiet) {
+			debug << "Init error code: " << error;
+			debug << "\nFace load error code: " << error;
+			debug << "\nfont filename: " << filename << " face index: " << face_index;
+		}
+		if (error) {
+			std::cerr << "problem loading face " << face_index << " of " << filename << "\n";
+			exit(1);
+		}
+		print_face();
+	}
+
+	void print_face()
+	{
+		if (quiet) return;
 		debug << "\nFamily Name: " << face->family_name;
 		debug << "\nStyle Name: " << face->style_name;
 		debug << "\nNumber of faces: " << face->num_faces;
 		debug << "\nNumber of glyphs: " << face->num_glyphs;
 	}
 
+	bool is_variable()
+	{
+		return FT_HAS_MULTIPLE_MASTERS( face );
+	}
+
+	// Design axes of a variable font, empty for ordinary fonts.
+	std::vector<var_axis> axes()
+	{
+		std::vector<var_axis> result;
+		FT_MM_Var *mm;
+		if (!is_variable() || FT_Get_MM_Var( face, &mm )) return result;
+		for ( FT_UInt i = 0 ; i < mm->num_axis ; i++ ) {
+			var_axis a;
+			for ( int k = 3 ; k >= 0 ; k-- )
+				a.tag += (char)((mm->axis[i].tag >> (k*8)) & 0xff);
+			a.name = mm->axis[i].name ? mm->axis[i].name : a.tag;
+			a.minimum = mm->axis[i].minimum / 65536.0;
+			a.def = mm->axis[i].def / 65536.0;
+			a.maximum = mm->axis[i].maximum / 65536.0;
+			result.push_back( a );
+		}
+		FT_Done_MM_Var( library, mm );
+		return result;
+	}
+
+	// Design coordinates of each named instance ('Bold', 'Condensed', ...)
+	std::vector< std::vector<double> > named_instances()
+	{
+		std::vector< std::vector<double> > result;
+		FT_MM_Var *mm;
+		if (!is_variable() || FT_Get_MM_Var( face, &mm )) return result;
+		for ( FT_UInt i = 0 ; i < mm->num_namedstyles ; i++ ) {
+			std::vector<double> coords;
+			for ( FT_UInt j = 0 ; j < mm->num_axis ; j++ )
+				coords.push_back( mm->namedstyle[i].coords[j] / 65536.0 );
+			result.push_back( coords );
+		}
+		FT_Done_MM_Var( library, mm );
+		return result;
+	}
+
+	/* Select an instance of a variable font by design coordinates, one per
+	axis in the order of axes(). Missing axes go back to their default.
+	Glyphs loaded afterwards come out in that instance. */
+	FT_Error set_design_coordinates( std::vector<double> coords )
+	{
+		std::vector<FT_Fixed> fixed;
+		for ( size_t i = 0 ; i < coords.size() ; i++ )
+			fixed.push_back( (FT_Fixed)(coords[i] * 65536.0 + (coords[i] < 0 ? -0.5 : 0.5)) );
+		error = FT_Set_Var_Design_Coordinates( face, fixed.size(), fixed.size() ? &fixed[0] : NULL );
+		if (!quiet) debug << "\nSet design coordinates. error code: " << error;
+		return error;
+	}
+
 	void free()
 	{
-		debug << "\n<!--";
-		error = FT_Done_Face( face );
-		debug << "\nFree face. error code: " << error;
+		FT_Error face_error = FT_Done_Face( face );
 		error = FT_Done_FreeType( library );
+		if (quiet) return;
+		debug << "\n<!--";
+		debug << "\nFree face. error code: " << face_error;
 		debug << "\nFree library. error code: " << error;
 		debug << "\n-->\n";
 	}
@@ -108,29 +251,31 @@ public:
 };
 
 
-/* Draw the outline of the font as svg.
-There are three main components.
+/* The outline walker. Every output format shares this one loop; what to
+write for each piece of the path is decided by an output 'policy' class,
+picked at compile time, with these members:
+
+	start( x, y )          first point of a contour
+	move( x, y )           contour restarts at an implied point (see below)
+	line( x, y )           line from the current point
+	quad( cx, cy, x, y )   quadratic Bezier from the current point
+	close()                end of contour
+
+There are three main components to an outline.
 1. the points
 2. the 'tags' for the points
 3. the contour indexes (that define which points belong to which contour)
-*/
-std::string do_outline(std::vector<FT_Vector> points, std::vector<char> tags, std::vector<short> contours)
-{
-	std::stringstream debug, svg;
-	std::cout << "<!-- do outline -->\n";
-	if (points.size()==0) return "<!-- font had 0 points -->";
-	if (contours.size()==0) return "<!-- font had 0 contours -->";
-	svg.str("");
-	svg << "\n\n  <!-- draw actual outline using lines and Bezier curves-->";
-	svg	<< "\n  <path fill='black' stroke='black'"
-		<< " fill-opacity='0.45' "
-		<< " stroke-width='2' "
-		<< " d='";
 
-	/* tag bit 1 indicates whether its a control point on a bez curve
-	or not. two consecutive control points imply another point halfway
-	between them */
+tag bit 1 indicates whether its a control point on a bez curve
+or not. two consecutive control points imply another point halfway
+between them
 
+'flip' negates y as the points are read. If 'debug' is given, a
+description of every step is written to it. */
+template <class Policy>
+void walk_outline( const FT_Vector *points, const char *tags, const short *contours,
+	int n_contours, Policy &out, bool flip = false, std::ostream *debug = NULL )
+{
 	// Step 1. move to starting point (M x-coord y-coord )
 	// Step 2. decide whether to draw a line or a bezier curve or to move
 	// Step 3. for bezier: Q control-point-x control-point-y,
@@ -138,99 +283,468 @@ std::string do_outline(std::vector<FT_Vector> points, std::vector<char> tags, st
 	//         for line:   L x-coord, y-coord
 	//         for move:   M x-coord, y-coord
 
+	FONT2SVG_TIME( outline );
+	long ys = flip ? -1 : 1;
 	int contour_starti = 0;
 	int contour_endi = 0;
-	for ( int i = 0 ; i < contours.size() ; i++ ) {
-		contour_endi = contours.at(i);
-		debug << "new contour starting. startpt index, endpt index:";
-		debug << contour_starti << "," << contour_endi << "\n";
+	for ( int i = 0 ; i < n_contours ; i++ ) {
+		contour_endi = contours[i];
 		int offset = contour_starti;
 		int npts = contour_endi - contour_starti + 1;
-		debug << "number of points in this contour: " << npts << "\n";
-		debug << "moving to first pt " << points[offset].x << "," << points[offset].y << "\n";
-		svg << "\n M " << points[contour_starti].x << "," << points[contour_starti].y << "\n";
-		debug << "listing pts: [this pt index][isctrl] <next pt index><isctrl> [x,y] <nx,ny>\n";
+		if (debug) {
+			*debug << "new contour starting. startpt index, endpt index:";
+			*debug << contour_starti << "," << contour_endi << "\n";
+			*debug << "number of points in this contour: " << npts << "\n";
+			*debug << "moving to first pt " << points[offset].x << "," << ys*points[offset].y << "\n";
+			*debug << "listing pts: [this pt index][isctrl] <next pt index><isctrl> [x,y] <nx,ny>\n";
+		}
+		out.start( points[contour_starti].x, ys*points[contour_starti].y );
 		for ( int j = 0; j < npts; j++ ) {
 			int thisi = j%npts + offset;
 			int nexti = (j+1)%npts + offset;
 			int nextnexti = (j+2)%npts + offset;
-			int x = points[thisi].x;
-			int y = points[thisi].y;
-			int nx = points[nexti].x;
-			int ny = points[nexti].y;
-			int nnx = points[nextnexti].x;
-			int nny = points[nextnexti].y;
-			bool this_tagbit1 = (tags[ thisi ] & 1);
-			bool next_tagbit1 = (tags[ nexti ] & 1);
-			bool nextnext_tagbit1 = (tags[ nextnexti ] & 1);
-			bool this_isctl = !this_tagbit1;
-			bool next_isctl = !next_tagbit1;
-			bool nextnext_isctl = !nextnext_tagbit1;
-			debug << " [" << thisi << "]";
-			debug << "[" << !this_tagbit1 << "]";
-			debug << " <" << nexti << ">";
-			debug << "<" << !next_tagbit1 << ">";
-			debug << " <<" << nextnexti << ">>";
-			debug << "<<" << !nextnext_tagbit1 << ">>";
-			debug << " [" << x << "," << y << "]";
-			debug << " <" << nx << "," << ny << ">";
-			debug << " <<" << nnx << "," << nny << ">>";
-			debug << "\n";
+			long x = points[thisi].x;
+			long y = ys*points[thisi].y;
+			long nx = points[nexti].x;
+			long ny = ys*points[nexti].y;
+			long nnx = points[nextnexti].x;
+			long nny = ys*points[nextnexti].y;
+			bool this_isctl = !(tags[ thisi ] & 1);
+			bool next_isctl = !(tags[ nexti ] & 1);
+			bool nextnext_isctl = !(tags[ nextnexti ] & 1);
+			if (debug) {
+				*debug << " [" << thisi << "]";
+				*debug << "[" << this_isctl << "]";
+				*debug << " <" << nexti << ">";
+				*debug << "<" << next_isctl << ">";
+				*debug << " <<" << nextnexti << ">>";
+				*debug << "<<" << nextnext_isctl << ">>";
+				*debug << " [" << x << "," << y << "]";
+				*debug << " <" << nx << "," << ny << ">";
+				*debug << " <<" << nnx << "," << nny << ">>";
+				*debug << "\n";
+			}
 
 			if (this_isctl && next_isctl) {
-				debug << " two adjacent ctl pts. adding point halfway between " << thisi << " and " << nexti << ":";
-				debug << " reseting x and y to ";
+				if (debug) {
+					*debug << " two adjacent ctl pts. adding point halfway between " << thisi << " and " << nexti << ":";
+					*debug << " reseting x and y to ";
+				}
 				x = (x + nx) / 2;
 				y = (y + ny) / 2;
 				this_isctl = false;
-				debug << " [" << x << "," << y <<"]\n";
+				if (debug) *debug << " [" << x << "," << y <<"]\n";
 				if (j==0) {
-					debug << "first pt in contour was ctrl pt. moving to non-ctrl pt\n";
-					svg << " M " << x << "," << y << "\n";
+					if (debug) *debug << "first pt in contour was ctrl pt. moving to non-ctrl pt\n";
+					out.move( x, y );
 				}
 			}
 
 			if (!this_isctl && next_isctl && !nextnext_isctl) {
-				svg << " Q " << nx << "," << ny << " " << nnx << "," << nny << "\n";
-				debug << " bezier to " << nnx << "," << nny << " ctlx, ctly: " << nx << "," << ny << "\n";
+				out.quad( nx, ny, nnx, nny );
+				if (debug) *debug << " bezier to " << nnx << "," << nny << " ctlx, ctly: " << nx << "," << ny << "\n";
 			} else if (!this_isctl && next_isctl && nextnext_isctl) {
-				debug << " two ctl pts coming. adding point halfway between " << nexti << " and " << nextnexti << ":";
-				debug << " reseting nnx and nny to halfway pt";
+				if (debug) {
+					*debug << " two ctl pts coming. adding point halfway between " << nexti << " and " << nextnexti << ":";
+					*debug << " reseting nnx and nny to halfway pt";
+				}
 				nnx = (nx + nnx) / 2;
 				nny = (ny + nny) / 2;
-				svg << " Q " << nx << "," << ny << " " << nnx << "," << nny << "\n";
-				debug << " bezier to " << nnx << "," << nny << " ctlx, ctly: " << nx << "," << ny << "\n";
+				out.quad( nx, ny, nnx, nny );
+				if (debug) *debug << " bezier to " << nnx << "," << nny << " ctlx, ctly: " << nx << "," << ny << "\n";
 			} else if (!this_isctl && !next_isctl) {
-				svg << " L " << nx << "," << ny << "\n";
-				debug << " line to " << nx << "," << ny << "\n";			
+				out.line( nx, ny );
+				if (debug) *debug << " line to " << nx << "," << ny << "\n";
 			} else if (this_isctl && !next_isctl) {
-				debug << " this is ctrl pt. skipping to " << nx << "," << ny << "\n";
+				if (debug) *debug << " this is ctrl pt. skipping to " << nx << "," << ny << "\n";
+				// contour starts on a ctrl pt: the curve through it is drawn
+				// last, ending at the next pt, so start there
+				if (j==0) out.move( nx, ny );
 			}
 		}
 		contour_starti = contour_endi+1;
-		svg << " Z\n";
+		out.close();
+	}
+}
+
+/* The walk, done once and kept as data: every command walk_outline() would
+give the policy, in order, implied on-curve points already worked out. */
+struct flat_op
+{
+	enum { START = 0, MOVE, LINE, QUAD, CLOSE };
+	int32_t op, cx, cy, x, y;
+};
+
+// (a + b) / 2, truncated toward zero like walk_outline's long division
+inline int32_t half_sum( int32_t a, int32_t b ) { return (a + b) / 2; }
+
+/* Outline -> flat_ops, in two passes. The first goes straight through
+all the points, with SSE2 where there is some: coordinates packed to
+32 bits (with y negated if 'flip'), tags reduced to on-curve flags, and the
+halfway point of each point and the next worked out. The second goes
+contour by contour, picking from those what each step of the walk needs.
+Coordinates must fit in 30 bits. Font units always do, but other points
+(26.6 pixels, scaled values) may not: then nothing is flattened, and it
+returns false, so the caller can use walk_outline() instead. */
+inline bool flatten_outline( const FT_Vector *points, const char *tags, const short *contours,
+	int n_points, int n_contours, std::pmr::vector<flat_op> &out, bool flip = false )
+{
+	FONT2SVG_TIME( outline );
+	out.clear();
+	if (n_points <= 0 || n_contours <= 0) return true;
+	const FT_Pos limit = (FT_Pos)1 << 30;
+	for ( int k = 0 ; k < n_points ; k++ )
+		if (points[k].x <= -limit || points[k].x >= limit || points[k].y <= -limit || points[k].y >= limit)
+			return false;
+	std::pmr::memory_resource *mr = out.get_allocator().resource();
+	std::pmr::vector<int32_t> xy( 2 * n_points, mr ), mid( 2 * n_points, mr );
+	std::pmr::vector<unsigned char> on( n_points, mr );
+	int32_t ys = flip ? -1 : 1;
+
+	int i = 0;
+#ifdef FONT2SVG_SSE2
+	if (sizeof(FT_Pos) == 8) {
+		// two points (four 64 bit numbers) at a time: keep the low halves
+		const __m128i neg = flip ? _mm_set_epi32( -1, 0, -1, 0 ) : _mm_setzero_si128();
+		for ( ; i + 2 <= n_points ; i += 2 ) {
+			__m128i a = _mm_loadu_si128( (const __m128i *)(points + i) );
+			__m128i b = _mm_loadu_si128( (const __m128i *)(points + i + 1) );
+			a = _mm_shuffle_epi32( a, _MM_SHUFFLE( 3, 1, 2, 0 ) );
+			b = _mm_shuffle_epi32( b, _MM_SHUFFLE( 3, 1, 2, 0 ) );
+			__m128i v = _mm_unpacklo_epi64( a, b );
+			v = _mm_sub_epi32( _mm_xor_si128( v, neg ), neg ); // -y is ~y + 1
+			_mm_storeu_si128( (__m128i *)&xy[2*i], v );
+		}
+	}
+#endif
+	for ( ; i < n_points ; i++ ) {
+		xy[2*i] = points[i].x;
+		xy[2*i+1] = ys * points[i].y;
+	}
+
+	i = 0;
+#ifdef FONT2SVG_SSE2
+	const __m128i one = _mm_set1_epi8( 1 );
+	for ( ; i + 16 <= n_points ; i += 16 )
+		_mm_storeu_si128( (__m128i *)&on[i],
+			_mm_and_si128( _mm_loadu_si128( (const __m128i *)(tags + i) ), one ) );
+#endif
+	for ( ; i < n_points ; i++ ) on[i] = tags[i] & 1;
+
+	// halfway to the next point; each contour's last point is fixed below
+	i = 0;
+#ifdef FONT2SVG_SSE2
+	for ( ; i + 2 < n_points ; i += 2 ) {
+		__m128i sum = _mm_add_epi32( _mm_loadu_si128( (const __m128i *)&xy[2*i] ),
+			_mm_loadu_si128( (const __m128i *)&xy[2*i+2] ) );
+		// adding the sign bit first makes the shift round toward zero
+		sum = _mm_srai_epi32( _mm_add_epi32( sum, _mm_srli_epi32( sum, 31 ) ), 1 );
+		_mm_storeu_si128( (__m128i *)&mid[2*i], sum );
+	}
+#endif
+	for ( ; i + 1 < n_points ; i++ ) {
+		mid[2*i] = half_sum( xy[2*i], xy[2*i+2] );
+		mid[2*i+1] = half_sum( xy[2*i+1], xy[2*i+3] );
+	}
+
+	out.reserve( n_points + 2 * n_contours );
+	int first = 0;
+	for ( int c = 0 ; c < n_contours ; c++ ) {
+		int last = contours[c];
+		if (last >= first) {
+			mid[2*last] = half_sum( xy[2*last], xy[2*first] );
+			mid[2*last+1] = half_sum( xy[2*last+1], xy[2*first+1] );
+		}
+		flat_op op = { flat_op::START, 0, 0, xy[2*first], xy[2*first+1] };
+		out.push_back( op );
+		for ( int t = first ; t <= last ; t++ ) {
+			int n1 = t == last ? first : t + 1;
+			int n2 = n1 == last ? first : n1 + 1;
+			bool ctl = !on[t], next_ctl = !on[n1];
+			if (ctl && next_ctl) {
+				// two ctrl pts in a row: the walk goes on from halfway between
+				ctl = false;
+				if (t == first) {
+					flat_op m = { flat_op::MOVE, 0, 0, mid[2*t], mid[2*t+1] };
+					out.push_back( m );
+				}
+			}
+			if (!ctl && next_ctl) {
+				const int32_t *to = on[n2] ? &xy[2*n2] : &mid[2*n1];
+				flat_op q = { flat_op::QUAD, xy[2*n1], xy[2*n1+1], to[0], to[1] };
+				out.push_back( q );
+			} else if (!ctl) {
+				flat_op l = { flat_op::LINE, 0, 0, xy[2*n1], xy[2*n1+1] };
+				out.push_back( l );
+			} else if (t == first) {
+				flat_op m = { flat_op::MOVE, 0, 0, xy[2*n1], xy[2*n1+1] };
+				out.push_back( m );
+			}
+		}
+		flat_op z = { flat_op::CLOSE, 0, 0, 0, 0 };
+		out.push_back( z );
+		first = last + 1;
+	}
+	return true;
+}
+
+/* Give flattened commands to an output policy, as walk_outline() would.
+'flip' negates y again (halving rounds toward zero, so this is exact). */
+template <class Policy>
+void play( const std::pmr::vector<flat_op> &ops, Policy &out, bool flip = false )
+{
+	FONT2SVG_TIME( outline );
+	long ys = flip ? -1 : 1;
+	for ( size_t i = 0 ; i < ops.size() ; i++ ) {
+		const flat_op &o = ops[i];
+		switch (o.op) {
+		case flat_op::START: out.start( o.x, ys*o.y ); break;
+		case flat_op::MOVE: out.move( o.x, ys*o.y ); break;
+		case flat_op::LINE: out.line( o.x, ys*o.y ); break;
+		case flat_op::QUAD: out.quad( o.cx, ys*o.cy, o.x, ys*o.y ); break;
+		case flat_op::CLOSE: out.close(); break;
+		}
+	}
+}
+
+// Output policy: svg path data, one command per line (as do_outline)
+struct svg_verbose
+{
+	text_stream svg;
+	void start( long x, long y ) { svg << "\n M " << x << "," << y << "\n"; }
+	void move( long x, long y ) { svg << " M " << x << "," << y << "\n"; }
+	void line( long x, long y ) { svg << " L " << x << "," << y << "\n"; }
+	void quad( long cx, long cy, long x, long y ) { svg << " Q " << cx << "," << cy << " " << x << "," << y << "\n"; }
+	void close() { svg << " Z\n"; }
+};
+
+// Output policy: compact svg path data, repeated commands left out
+struct svg_compact
+{
+	text_stream svg;
+	char mode;
+	svg_compact() : mode('Z') {}
+	void command( char c ) { if (mode != c) svg << c; else svg << " "; mode = c; }
+	void start( long x, long y ) { svg << "M" << x << "," << y; mode = 'M'; }
+	// a move always gets its letter: numbers after an M are line-tos
+	void move( long x, long y ) { svg << "M" << x << "," << y; mode = 'M'; }
+	void line( long x, long y ) { command( 'L' ); svg << x << " " << y; }
+	void quad( long cx, long cy, long x, long y ) { command( 'Q' ); svg << cx << " " << cy << " " << x << " " << y; }
+	void close() { svg << "Z"; mode = 'Z'; }
+};
+
+// Output policy: binary path, an opcode followed by its coordinates
+struct path_binary
+{
+	enum { MOVE = 0, LINE = 1, QUAD = 2, CLOSE = 3 };
+	std::vector<int> data;
+	void start( long x, long y ) { move( x, y ); }
+	void move( long x, long y ) { data.push_back( MOVE ); data.push_back( x ); data.push_back( y ); }
+	void line( long x, long y ) { data.push_back( LINE ); data.push_back( x ); data.push_back( y ); }
+	void quad( long cx, long cy, long x, long y )
+	{
+		data.push_back( QUAD );
+		data.push_back( cx ); data.push_back( cy );
+		data.push_back( x ); data.push_back( y );
+	}
+	void close() { data.push_back( CLOSE ); }
+};
+
+/* One piece of a reconstructed outline. Lines leave 'c' equal to 'p0'.
+Segments start wherever the 'pen' was left by the previous segment, just
+as the SVG path from do_outline() does, and each contour is closed with a
+line back to its starting point (the SVG 'Z'). */
+struct segment
+{
+	enum kind { line, quad };
+	kind type;
+	int contour;
+	FT_Vector p0, c, p1;
+};
+
+// Output policy: geometry, for distance fields and rasterizers
+struct segment_collector
+{
+	std::vector<segment> segs;
+	FT_Vector pen, first;
+	int contour;
+	segment_collector() : contour(-1) {}
+	void add( segment::kind type, long cx, long cy, long x, long y )
+	{
+		segment s;
+		s.type = type;
+		s.contour = contour;
+		s.p0 = pen;
+		s.c.x = cx; s.c.y = cy;
+		s.p1.x = x; s.p1.y = y;
+		segs.push_back( s );
+		pen = s.p1;
+	}
+	void start( long x, long y ) { contour++; move( x, y ); }
+	void move( long x, long y ) { pen.x = first.x = x; pen.y = first.y = y; }
+	void line( long x, long y ) { add( segment::line, pen.x, pen.y, x, y ); }
+	void quad( long cx, long cy, long x, long y ) { add( segment::quad, cx, cy, x, y ); }
+	void close() { if (pen.x != first.x || pen.y != first.y) line( first.x, first.y ); }
+};
+
+/* Output policy: black and white bitmap, filled with the non-zero rule
+at pixel centers. Pixel = font unit * scale + (dx,dy). Curves are cut
+into short lines first. Call fill() once the walk is done. */
+struct raster
+{
+	int width, height;
+	double scale, dx, dy;
+	std::vector<unsigned char> pixels;
+	struct edge { double x0, y0, x1, y1; };
+	std::vector<edge> edges;
+	double penx, peny, firstx, firsty;
+
+	raster( int w, int h, double s, double x, double y )
+		: width(w), height(h), scale(s), dx(x), dy(y), pixels( w*h, 0 ),
+		  penx(0), peny(0), firstx(0), firsty(0) {}
+	void to( double x, double y )
+	{
+		edge e = { penx, peny, x, y };
+		if (peny != y) edges.push_back( e );
+		penx = x; peny = y;
+	}
+	void start( long x, long y ) { move( x, y ); }
+	void move( long x, long y )
+	{
+		close();
+		penx = firstx = x*scale + dx;
+		peny = firsty = y*scale + dy;
+	}
+	void line( long x, long y ) { to( x*scale + dx, y*scale + dy ); }
+	void quad( long cx, long cy, long x, long y )
+	{
+		double x0 = penx, y0 = peny;
+		double x1 = cx*scale + dx, y1 = cy*scale + dy;
+		double x2 = x*scale + dx, y2 = y*scale + dy;
+		const int steps = 16;
+		for ( int k = 1 ; k <= steps ; k++ ) {
+			double t = double(k) / steps, u = 1 - t;
+			to( u*u*x0 + 2*u*t*x1 + t*t*x2, u*u*y0 + 2*u*t*y1 + t*t*y2 );
+		}
+	}
+	void close() { to( firstx, firsty ); }
+	void fill()
+	{
+		std::vector< std::pair<double,int> > xs;
+		for ( int row = 0 ; row < height ; row++ ) {
+			double py = row + 0.5;
+			xs.clear();
+			for ( size_t i = 0 ; i < edges.size() ; i++ ) {
+				const edge &e = edges[i];
+				if ((py < e.y0) == (py < e.y1)) continue;
+				double t = (py - e.y0) / (e.y1 - e.y0);
+				xs.push_back( std::make_pair( e.x0 + t*(e.x1 - e.x0), e.y1 > e.y0 ? 1 : -1 ) );
+			}
+			std::sort( xs.begin(), xs.end() );
+			size_t k = 0;
+			int winding = 0;
+			for ( int col = 0 ; col < width ; col++ ) {
+				while (k < xs.size() && xs[k].first <= col + 0.5) winding += xs[k++].second;
+				pixels[ row*width + col ] = winding ? 255 : 0;
+			}
+		}
 	}
-	svg << "\n  '/>";
-	std::cout << "\n<!--\n" << debug.str() << " \n-->\n";
-	return svg.str();
+};
+
+/* Draw the outline of the font as svg. 'flip' negates y, for points in
+FreeType's (y up) orientation. */
+inline std::string do_outline( const FT_Vector *points, const char *tags, const short *contours, int n_points, int n_contours, bool flip = false )
+{
+	FONT2SVG_TIME( format );
+	if (!quiet) std::cout << "<!-- do outline -->\n";
+	if (n_points==0) return "<!-- font had 0 points -->";
+	if (n_contours==0) return "<!-- font had 0 contours -->";
+	text_stream debug;
+	svg_verbose out;
+	out.svg << "\n\n  <!-- draw actual outline using lines and Bezier curves-->";
+	out.svg	<< "\n  <path fill='black' stroke='black'"
+		<< " fill-opacity='0.45' "
+		<< " stroke-width='2' "
+		<< " d='";
+	std::pmr::vector<flat_op> ops;
+	if (quiet && flatten_outline( points, tags, contours, n_points, n_contours, ops, flip ))
+		play( ops, out );
+	else
+		walk_outline( points, tags, contours, n_contours, out, flip, quiet ? NULL : &debug );
+	out.svg << "\n  '/>";
+	if (!quiet) std::cout << "\n<!--\n" << debug.str() << " \n-->\n";
+	return out.svg.str();
+}
+
+inline std::string do_outline(std::vector<FT_Vector> points, std::vector<char> tags, std::vector<short> contours)
+{
+	return do_outline( points.size() ? &points[0] : NULL, tags.size() ? &tags[0] : NULL,
+		contours.size() ? &contours[0] : NULL, points.size(), contours.size() );
+}
+
+/* Same walk as do_outline() but producing segments instead of text, for
+consumers that want geometry (distance fields, rasterizers). */
+inline std::vector<segment> outline_segments( const FT_Vector *points, const char *tags, const short *contours, int n_points, int n_contours, bool flip = false )
+{
+	segment_collector out;
+	if (n_points==0 || n_contours==0) return out.segs;
+	std::pmr::vector<flat_op> ops;
+	if (flatten_outline( points, tags, contours, n_points, n_contours, ops, flip )) play( ops, out );
+	else walk_outline( points, tags, contours, n_contours, out, flip );
+	return out.segs;
+}
+
+inline std::vector<segment> outline_segments( const std::vector<FT_Vector> &points, const std::vector<char> &tags, const std::vector<short> &contours )
+{
+	return outline_segments( points.size() ? &points[0] : NULL, tags.size() ? &tags[0] : NULL,
+		contours.size() ? &contours[0] : NULL, points.size(), contours.size() );
 }
 
+/* A glyph outline copied out of FreeType's glyph slot. FreeType reuses
+the slot for the next glyph loaded on the face, so a glyph that wants to
+be kept around needs its own copy. 'path' is the same outline flattened,
+with y down as in svg, so output only has to format it (it is loaded in
+font units, which always fit flat_op). */
+struct outline_data
+{
+	std::pmr::vector<FT_Vector> points;
+	std::pmr::vector<char> tags;
+	std::pmr::vector<short> contours;
+	std::pmr::vector<flat_op> path;
+
+	outline_data( const FT_Outline &o, std::pmr::memory_resource *mr )
+		: points( o.points, o.points + o.n_points, mr ),
+		tags( o.tags, o.tags + o.n_points, mr ),
+		contours( o.contours, o.contours + o.n_contours, mr ),
+		path( mr )
+	{
+		flatten_outline( o.points, o.tags, o.contours, o.n_points, o.n_contours, path, true );
+	}
+};
+
 class glyph
 {
 public:
 	int codepoint;
-	FT_GlyphSlot slot;
+	FT_UInt index;
 	FT_Error error;
-	FT_Outline ftoutline;
 	FT_Glyph_Metrics gm;
 	FT_Face face;
 	ttf_file file;
 
-	FT_Vector* ftpoints;
-	char* tags;
-	short* contours;
+	/* The outline, in font units with y up as in the font; the output
+	methods flip y for svg. It is never changed after loading, so anything
+	holding this shared_ptr to it can keep using it, and other glyphs can be
+	loaded from the face while this one is in use. */
+	std::shared_ptr<const outline_data> shape;
+
+	// the same outline as an FT_Outline, and its arrays (read only)
+	FT_Outline ftoutline;
+	const FT_Vector *ftpoints;
+	const char *tags;
+	const short *contours;
 
-	std::stringstream debug, tmp;
+	text_stream debug, tmp;
 	int bbwidth, bbheight;
 
 	glyph( ttf_file &f, std::string unicode_str )
@@ -251,6 +765,24 @@ public:
 		init( std::string(unicode_c_str) );
 	}
 
+	/* For callers that already looked up the glyph index and name. The
+	outline copy is allocated from 'mr'. */
+	glyph( ttf_file &f, int cp, FT_UInt glyph_index, const char *glyph_name,
+		std::pmr::memory_resource *mr = std::pmr::get_default_resource() )
+	{
+		// only the handles; copying the file name would cost an allocation
+		file.library = f.library;
+		file.face = f.face;
+		file.error = f.error;
+		codepoint = cp;
+		if (!quiet) {
+			debug << "<!--\nUnicode requested: " << cp;
+			debug << " (decimal: " << codepoint << " hex: 0x"
+				<< std::hex << codepoint << std::dec << ")";
+		}
+		load( glyph_index, glyph_name, mr );
+	}
+
 	void free()
 	{
 		file.free();
@@ -260,19 +792,48 @@ public:
 	{
 		face = file.face;
 		codepoint = strtol( unicode_s.c_str() , NULL, 0 );
-		// Load the Glyph into the face's Glyph Slot + print details
 		FT_UInt glyph_index = FT_Get_Char_Index( face, codepoint );
-		debug << "<!--\nUnicode requested: " << unicode_s;
-		debug << " (decimal: " << codepoint << " hex: 0x"
-			<< std::hex << codepoint << std::dec << ")";
+		char glyph_name[1024] = "";
+		if (!quiet) {
+			debug << "<!--\nUnicode requested: " << unicode_s;
+			debug << " (decimal: " << codepoint << " hex: 0x"
+				<< std::hex << codepoint << std::dec << ")";
+			FT_Get_Glyph_Name( face, glyph_index, glyph_name, 1024 );
+		}
+		load( glyph_index, glyph_name );
+	}
+
+	// Load the Glyph into the face's Glyph Slot, copy it out + print details
+	void load( FT_UInt glyph_index, const char *glyph_name,
+		std::pmr::memory_resource *mr = std::pmr::get_default_resource() )
+	{
+		face = file.face;
+		index = glyph_index;
+		{
+			FONT2SVG_TIME( glyph_load );
+			error = FT_Load_Glyph( face, glyph_index, FT_LOAD_NO_SCALE );
+		}
+		FT_GlyphSlot slot = face->glyph;
+		gm = slot->metrics;
+		{
+			FONT2SVG_TIME( copy );
+			shape = std::allocate_shared<outline_data>(
+				std::pmr::polymorphic_allocator<outline_data>( mr ), slot->outline, mr );
+		}
+		ftoutline = slot->outline;
+		ftoutline.points = const_cast<FT_Vector *>( ftpoints = shape->points.data() );
+		ftoutline.tags = const_cast<char *>( tags = shape->tags.data() );
+		ftoutline.contours = const_cast<short *>( contours = shape->contours.data() );
+		FONT2SVG_COUNT( glyphs, 1 );
+		FONT2SVG_COUNT( points, ftoutline.n_points );
+		FONT2SVG_COUNT( contours, ftoutline.n_contours );
+
+		bbheight = face->bbox.yMax - face->bbox.yMin;
+		bbwidth = face->bbox.xMax - face->bbox.xMin;
+
+		if (quiet) return;
 		debug << "\nGlyph index for unicode: " << glyph_index;
-		error = FT_Load_Glyph( face, glyph_index, FT_LOAD_NO_SCALE );
 		debug << "\nLoad Glyph into Face's glyph slot. error code: " << error;
-		slot = face->glyph;
-		ftoutline = slot->outline;
-		char glyph_name[1024];
-		FT_Get_Glyph_Name( face, glyph_index, glyph_name, 1024 );
-		gm = slot->metrics;
 		debug << "\nGlyph Name: " << glyph_name;
 		debug << "\nGlyph Width: " << gm.width
 			<< " Height: " << gm.height
@@ -285,20 +846,11 @@ public:
 		debug << "\nContour endpoint index values:";
 		for ( int i = 0 ; i < ftoutline.n_contours ; i++ ) debug << " " << ftoutline.contours[i];
 		debug << "\n-->\n";
-
-		// Invert y coordinates (SVG = neg at top, TType = neg at bottom)
-		ftpoints = ftoutline.points;
-		for ( int i = 0 ; i < ftoutline.n_points ; i++ )
-			ftpoints[i].y *= -1;
-
-		bbheight = face->bbox.yMax - face->bbox.yMin;
-		bbwidth = face->bbox.xMax - face->bbox.xMin;
-		tags = ftoutline.tags;
-		contours = ftoutline.contours;
 		std::cout << debug.str();
 	}
 
 	std::string svgheader() {
+		FONT2SVG_TIME( format );
 		tmp.str("");
 
 		tmp << "\n<svg width='" << bbwidth << "px'"
@@ -309,6 +861,7 @@ public:
 	}
 
 	std::string svgborder()  {
+		FONT2SVG_TIME( format );
 		tmp.str("");
 		tmp << "\n\n <!-- draw border -->";
 
@@ -319,12 +872,13 @@ public:
 	}
 
 	std::string svgtransform() {
+		FONT2SVG_TIME( format );
 		// TrueType points are not in the range usually visible by SVG.
 		// they often have negative numbers etc. So.. here we
 		// 'transform' to make visible.
 		//
-		// note also that y coords of all points have been flipped during
-		// init() so that SVG Y positive = Truetype Y positive
+		// note also that y coords of all points are flipped as they are
+		// written, so that SVG Y positive = Truetype Y positive
 		tmp.str("");
 		tmp << "\n\n <!-- make sure glyph is visible within svg window -->";
 		int yadj = gm.horiBearingY + gm.vertBearingY + 100;
@@ -336,6 +890,7 @@ public:
 	}
 
 	std::string axes()  {
+		FONT2SVG_TIME( format );
 		tmp.str("");
 		tmp << "\n\n  <!-- draw axes --> ";
 		tmp << "\n <path stroke='blue' stroke-dasharray='5,5' d='"
@@ -348,6 +903,7 @@ public:
 	}
 
 	std::string typography_box()  {
+		FONT2SVG_TIME( format );
 		tmp.str("");
 		tmp << "\n\n  <!-- draw bearing + advance box --> ";
 		int x1 = 0;
@@ -366,15 +922,16 @@ public:
 	}
 
 	std::string points()  {
+		FONT2SVG_TIME( format );
 		tmp.str("");
 		tmp << "\n\n  <!-- draw points as circles -->";
 		for ( int i = 0 ; i < ftoutline.n_points ; i++ ) {
 			bool this_is_ctrl_pt = !(tags[i] & 1);
 			bool next_is_ctrl_pt = !(tags[(i+1)%ftoutline.n_points] & 1);
 			int x = ftpoints[i].x;
-			int y = ftpoints[i].y;
+			int y = -ftpoints[i].y;
 			int nx = ftpoints[(i+1)%ftoutline.n_points].x;
-			int ny = ftpoints[(i+1)%ftoutline.n_points].y;
+			int ny = -ftpoints[(i+1)%ftoutline.n_points].y;
 			int radius = 5;
 			if ( i == 0 ) radius = 10;
 			std::string color;
@@ -392,7 +949,7 @@ public:
 			tmp << "<circle"
 				<< " fill='" << color << "'"
 				<< " stroke='black'"
-				<< " cx='" << ftpoints[i].x << "' cy='" << ftpoints[i].y << "'"
+				<< " cx='" << ftpoints[i].x << "' cy='" << -ftpoints[i].y << "'"
 				<< " r='" << radius << "'"
 				<< "/>";
 		}
@@ -401,10 +958,12 @@ public:
 	}
 
 	std::string pointlines()  {
+		FONT2SVG_TIME( format );
 		tmp.str("");
 		tmp << "\n\n  <!-- draw straight lines between points -->";
+		if (ftoutline.n_points==0) return tmp.str();
 		tmp << "\n  <path fill='none' stroke='green' d='";
-		tmp << "\n   M " << ftpoints[0].x << "," << ftpoints[0].y << "\n";
+		tmp << "\n   M " << ftpoints[0].x << "," << -ftpoints[0].y << "\n";
 		tmp << "\n  '/>";
 		for ( int i = 0 ; i < ftoutline.n_points-1 ; i++ ) {
 			std::string dash_mod("");
@@ -415,22 +974,23 @@ public:
 			tmp << "\n  <path fill='none' stroke='green'";
 			tmp << dash_mod;
 			tmp << " d='";
- 			tmp << " M " << ftpoints[i].x << "," << ftpoints[i].y;
- 			tmp << " L " << ftpoints[(i+1)%ftoutline.n_points].x << "," << ftpoints[(i+1)%ftoutline.n_points].y;
+ 			tmp << " M " << ftpoints[i].x << "," << -ftpoints[i].y;
+ 			tmp << " L " << ftpoints[(i+1)%ftoutline.n_points].x << "," << -ftpoints[(i+1)%ftoutline.n_points].y;
 			tmp << "\n  '/>";
 		}
 		return tmp.str();
 	}
 
 	std::string labelpts() {
+		FONT2SVG_TIME( format );
 		tmp.str("");
 		for ( int i = 0 ; i < ftoutline.n_points ; i++ ) {
 			tmp << "\n <g font-family='SVGFreeSansASCII,sans-serif' font-size='10'>\n";
 			tmp << "  <text id='revision'";
 			tmp << " x='" << ftpoints[i].x + 5 << "'";
-			tmp << " y='" << ftpoints[i].y - 5 << "'";
+			tmp << " y='" << -ftpoints[i].y - 5 << "'";
 			tmp << " stroke='none' fill='darkgreen'>\n";
-			tmp << "  " << ftpoints[i].x  << "," << ftpoints[i].y;
+			tmp << "  " << ftpoints[i].x  << "," << -ftpoints[i].y;
 			tmp << "  </text>\n";
 			tmp << " </g>\n";
 		}
@@ -438,19 +998,64 @@ public:
 	}
 
 	std::string outline()  {
-		std::vector<FT_Vector> pointsv(ftpoints,ftpoints+ftoutline.n_points);
-		std::vector<char> tagsv(tags,tags+ftoutline.n_points);
-		std::vector<short> contoursv(contours,contours+ftoutline.n_contours);
-		return do_outline(pointsv, tagsv, contoursv);
+		if (!quiet || ftoutline.n_points==0 || ftoutline.n_contours==0)
+			return do_outline(ftpoints, tags, contours, ftoutline.n_points, ftoutline.n_contours, true);
+		FONT2SVG_TIME( format );
+		svg_verbose out;
+		out.svg << "\n\n  <!-- draw actual outline using lines and Bezier curves-->";
+		out.svg	<< "\n  <path fill='black' stroke='black'"
+			<< " fill-opacity='0.45' "
+			<< " stroke-width='2' "
+			<< " d='";
+		play( shape->path, out );
+		out.svg << "\n  '/>";
+		return out.svg.str();
+	}
+
+	std::vector<segment> segments()  {
+		segment_collector out;
+		play( shape->path, out );
+		return out.segs;
+	}
+
+	/* The outline through any output policy (svg_compact, path_binary,
+	raster...), with y down as in svg, or with y up if 'flip' is given. */
+	template <class Policy>
+	void emit( Policy &out, bool flip = false )  {
+		play( shape->path, out, flip );
 	}
 
 	std::string svgfooter()  {
+		FONT2SVG_TIME( format );
 		tmp.str("");
 		tmp << "\n </g>\n</svg>\n";
 		return tmp.str();
 	}
 };
 
+/* The glyph drawn as svgheader() + svgtransform() + outline() +
+svgfooter() draw it, in one fixed form: no comments, compact path data,
+one line. The bytes depend only on the glyph's outline and metrics (and
+the face's bounding box), not on 'quiet', the global locale, or what else
+was converted before, so they can be hashed and cached by content. The
+form only changes with a new version of this function. */
+inline std::string canonical_document( glyph &g )
+{
+	FONT2SVG_TIME( format );
+	svg_compact path;
+	g.emit( path );
+	text_stream out;
+	out << "<svg width='" << g.bbwidth << "px' height='" << g.bbheight << "px'"
+		<< " xmlns='http://www.w3.org/2000/svg' version='1.1'>"
+		<< "<g fill-rule='nonzero' transform='translate(100 "
+		<< (int)(g.gm.horiBearingY + g.gm.vertBearingY + 100) << ")'>";
+	if (g.ftoutline.n_points && g.ftoutline.n_contours)
+		out << "<path fill='black' stroke='black' fill-opacity='0.45' stroke-width='2'"
+			<< " d='" << path.svg.str() << "'/>";
+	out << "</g></svg>\n";
+	return out.str();
+}
+
 } // namespace
 
 #endif
@@ -44,10 +44,11 @@
  
  */
 
-#ifndef __font_to_svg_h__
-#define __font_to_svg_h__
+#ifndef __font_to_svg2_h__
+#define __font_to_svg2_h__
 
-#include "Stdafx.h"
+// the outline walker and the font loading are shared with font_to_svg.hpp
+#include "font_to_svg.hpp"
 
 #include <ft2build.h>
 #include FT_FREETYPE_H
@@ -58,69 +59,39 @@
 
 namespace LatexDrawGraphics {
     
-    std::stringstream debug;
-        
-    class CFreeType
-    {
-    public:
-        std::string filename;
-        FT_Library library;
-        FT_Face face;
-        FT_Error error;
-        
-        CFreeType()
-        {
-            filename = std::string("");
-        }
-        
-        CFreeType( std::string fname )
-        {
-            filename = fname;
-            error = FT_Init_FreeType( &library );
-            debug << "Init error code: " << error;
-            
-            // Load a typeface
-            error = FT_New_Face( library, filename.c_str(), 0, &face );
-            debug << "\nFace load error code: " << error;
-            debug << "\nfont filename: " << filename;
-            if (error) {
-                std::cerr << "problem loading file " << filename << "\n";
-                exit(1);
-            }
-            debug << "\nFamily Name: " << face->family_name;
-            debug << "\nStyle Name: " << face->style_name;
-            debug << "\nNumber of faces: " << face->num_faces;
-            debug << "\nNumber of glyphs: " << face->num_glyphs;
-        }
-        
-        void free()
-        {
-            debug << "\n<!--";
-            error = FT_Done_Face( face );
-            debug << "\nFree face. error code: " << error;
-            error = FT_Done_FreeType( library );
-            debug << "\nFree library. error code: " << error;
-            debug << "\n-->\n";
-        }
-        
-    };
-    
+    typedef font2svg::ttf_file CFreeType;
     
+    /* The character to draw: the character itself, UTF-8 encoded, like
+     "B", or a number of two or more digits like "66" or "0x42". */
+    inline int parse_codepoint( const std::string &s )
+    {
+        char *end = NULL;
+        long n = strtol( s.c_str(), &end, 0 );
+        if (s.size() > 1 && *end == 0) return n;
+        const unsigned char *u = (const unsigned char *)s.c_str();
+        if (u[0] < 0x80) return u[0];
+        int extra = u[0] >= 0xF0 ? 3 : u[0] >= 0xE0 ? 2 : 1;
+        int cp = u[0] & (0x3F >> extra);
+        for ( int k = 1 ; k <= extra && (u[k] & 0xC0) == 0x80 ; k++ )
+            cp = (cp << 6) | (u[k] & 0x3F);
+        return cp;
+    }
     
     class CFreeGlypth
     {
     public:
         int _codepoint;
-        FT_GlyphSlot _slot;
         FT_Error _error;
         FT_Outline _outline;
         FT_Glyph_Metrics _gm;
         FT_Face _face;
         CFreeType _file;
         
-        FT_Vector* _points;
-        char* _tags;
-        short* _contours;
+        // own copy of the outline, y up as in the font (see font2svg::glyph)
+        std::shared_ptr<const font2svg::outline_data> _shape;
+        const FT_Vector* _points;
+        const char* _tags;
+        const short* _contours;
         
         long _bbwidth, _bbheight;
         
@@ -149,8 +120,9 @@ namespace LatexDrawGraphics {
         
         void init( std::string unicode_s )
         {
+            font2svg::text_stream debug;
             _face = _file.face;
-            _codepoint = unicode_s.c_str()[0];
+            _codepoint = parse_codepoint( unicode_s );
             
             // Load the Glyph into the face's Glyph Slot + print details
             FT_UInt glyph_index = FT_Get_Char_Index( _face, _codepoint );
@@ -161,12 +133,16 @@ namespace LatexDrawGraphics {
             debug << "\nGlyph index for unicode: " << glyph_index;
             _error = FT_Load_Glyph( _face, glyph_index, FT_LOAD_NO_SCALE );
             debug << "\nLoad Glyph into Face's glyph slot. error code: " << _error;
-            _slot = _face->glyph;
-            _outline = _slot->outline;
+            FT_GlyphSlot slot = _face->glyph;
+            _shape = std::make_shared<font2svg::outline_data>( slot->outline, std::pmr::get_default_resource() );
+            _outline = slot->outline;
+            _outline.points = const_cast<FT_Vector*>( _points = _shape->points.data() );
+            _outline.tags = const_cast<char*>( _tags = _shape->tags.data() );
+            _outline.contours = const_cast<short*>( _contours = _shape->contours.data() );
             
             char glyph_name[1024];
             FT_Get_Glyph_Name( _face, glyph_index, glyph_name, 1024 );
-            _gm = _slot->metrics;
+            _gm = slot->metrics;
             debug << "\nGlyph Name: " << glyph_name;
             debug << "\nGlyph Width: " << _gm.width
             << " Height: " << _gm.height
@@ -180,22 +156,15 @@ namespace LatexDrawGraphics {
             for ( int i = 0 ; i < _outline.n_contours ; i++ ) debug << " " << _outline.contours[i];
             debug << "\n-->\n";
             
-            // Invert y coordinates (SVG = neg at top, TType = neg at bottom)
-            _points = _outline.points;
-            for ( int i = 0 ; i < _outline.n_points ; i++ )
-                _points[i].y *= -1;
-            
             _bbheight = _face->bbox.yMax - _face->bbox.yMin;
             _bbwidth = _face->bbox.xMax - _face->bbox.xMin;
-            _tags = _outline.tags;
-            _contours = _outline.contours;
-            std::cout << debug.str();
+            if (!font2svg::quiet) std::cout << debug.str();
         }
         
         
         // Create Header
         std::string svgheader() {
-            std::stringstream tmp;
+            font2svg::text_stream tmp;
 
             tmp << "\n<svg width='" << _bbwidth << "px'"
             << " height='" << _bbheight << "px'"
@@ -206,7 +175,7 @@ namespace LatexDrawGraphics {
         
         // Draw Border
         std::string svgborder()  {
-            std::stringstream tmp;
+            font2svg::text_stream tmp;
             
             tmp << "\n <rect fill='none' stroke='black'"
             << " width='" << _bbwidth - 1 << "'"
@@ -220,9 +189,9 @@ namespace LatexDrawGraphics {
             // they often have negative numbers etc. So.. here we
             // 'transform' to make visible.
             //
-            // note also that y coords of all points have been flipped during
-            // init() so that SVG Y positive = Truetype Y positive
-            std::stringstream tmp("");
+            // note also that outline() writes the points with TrueType's y
+            // (it flips the stored path back), so no flip is done here
+            font2svg::text_stream tmp;
             long yadj = _gm.horiBearingY + _gm.vertBearingY + 100;
             long xadj = 100;
             
@@ -235,7 +204,7 @@ namespace LatexDrawGraphics {
         // Add Axis
         std::string axes()
         {
-            std::stringstream tmp("");
+            font2svg::text_stream tmp;
             tmp << "\n\n  <!-- draw axes --> ";
             tmp << "\n <path stroke='blue' stroke-dasharray='5,5' d='"
             << " M" << - _bbwidth << "," << 0
@@ -249,7 +218,7 @@ namespace LatexDrawGraphics {
         // Draw Bearing + Advance Box
         std::string typography_box()
         {
-            std::stringstream tmp("");
+            font2svg::text_stream tmp;
 
             long x1 = 0;
             long x2 =   _gm.horiAdvance;
@@ -271,15 +240,15 @@ namespace LatexDrawGraphics {
         // Draw points as circles
         std::string points()
         {
-            std::stringstream tmp("");
+            font2svg::text_stream tmp;
 
             for ( int i = 0 ; i < _outline.n_points ; i++ ) {
                 bool this_is_ctrl_pt = !(_tags[i] & 1);
                 bool next_is_ctrl_pt = !(_tags[(i+1) % _outline.n_points] & 1);
                 long x = _points[i].x;
-                long y = _points[i].y;
+                long y = -_points[i].y;
                 long nx = _points[(i+1) % _outline.n_points].x;
-                long ny = _points[(i+1) % _outline.n_points].y;
+                long ny = -_points[(i+1) % _outline.n_points].y;
                 int radius = 5;
                 if ( i == 0 ) radius = 10;
                 
@@ -298,7 +267,7 @@ namespace LatexDrawGraphics {
                 tmp << "<circle"
                 << " fill='" << color << "'"
                 << " stroke='black'"
-                << " cx='" << _points[i].x << "' cy='" << _points[i].y << "'"
+                << " cx='" << _points[i].x << "' cy='" << -_points[i].y << "'"
                 << " r='" << radius << "'"
                 << "/>";
             }
@@ -310,9 +279,10 @@ namespace LatexDrawGraphics {
         // Draw straight lines between points
         std::string pointlines()
         {
-            std::stringstream tmp("");
+            font2svg::text_stream tmp;
+            if (_outline.n_points==0) return tmp.str();
             tmp << "\n  <path fill='none' stroke='green' d='";
-            tmp << "\n   M " << _points[0].x << "," << _points[0].y << "\n";
+            tmp << "\n   M " << _points[0].x << "," << -_points[0].y << "\n";
             tmp << "\n  '/>";
             
             for ( int i = 0 ; i < _outline.n_points-1 ; i++ ) {
@@ -324,8 +294,8 @@ namespace LatexDrawGraphics {
                 tmp << "\n  <path fill='none' stroke='green'";
                 tmp << dash_mod;
                 tmp << " d='";
-                tmp << " M " << _points[i].x << "," << _points[i].y;
-                tmp << " L " << _points[(i+1) % _outline.n_points].x << "," << _points[(i+1) % _outline.n_points].y;
+                tmp << " M " << _points[i].x << "," << -_points[i].y;
+                tmp << " L " << _points[(i+1) % _outline.n_points].x << "," << -_points[(i+1) % _outline.n_points].y;
                 tmp << "\n  '/>";
             }
             return tmp.str();
@@ -334,14 +304,14 @@ namespace LatexDrawGraphics {
         // Label points
         std::string labelpts()
         {
-            std::stringstream tmp("");
+            font2svg::text_stream tmp;
             for ( int i = 0 ; i < _outline.n_points ; i++ ) {
                 tmp << "\n <g font-family='SVGFreeSansASCII,sans-serif' font-size='10'>\n";
                 tmp << "  <text id='revision'";
                 tmp << " x='" << _points[i].x + 5 << "'";
-                tmp << " y='" << _points[i].y - 5 << "'";
+                tmp << " y='" << -_points[i].y - 5 << "'";
                 tmp << " stroke='none' fill='darkgreen'>\n";
-                tmp << "  " << _points[i].x  << "," << _points[i].y;
+                tmp << "  " << _points[i].x  << "," << -_points[i].y;
                 tmp << "  </text>\n";
                 tmp << " </g>\n";
             }
@@ -349,123 +319,18 @@ namespace LatexDrawGraphics {
         }
         
         
-        /* Draw the outline of the font as svg.
-         There are three main components.
-         1. the points
-         2. the 'tags' for the points
-         3. the contour indexes (that define which points belong to which contour)
-         */
+        // Draw the outline of the font as compact svg path data
         std::string outline()
         {
             if (_outline.n_points==0) return "<!-- font had 0 points -->";
             if (_outline.n_contours==0) return "<!-- font had 0 contours -->";
-           
-            std::stringstream svg;
-            
-            svg << "d='";
-            
-            /* tag bit 1 indicates whether its a control point on a bez curve
-             or not. two consecutive control points imply another point halfway
-             between them */
-            
-            // Step 1. move to starting point (M x-coord y-coord )
-            // Step 2. decide whether to draw a line or a bezier curve or to move
-            // Step 3. for bezier: Q control-point-x control-point-y,
-            //		         destination-x, destination-y
-            //         for line:   L x-coord, y-coord
-            //         for move:   M x-coord, y-coord
-            
-            int contour_starti = 0;
-            
-            // Create a local copy of pointers
-            FT_Outline outline = _outline;
-            FT_Vector* points = _points;
-            char* tags = _tags;
-            short* contours = _contours;
-            
             
-            for (int i = 0 ; i < outline.n_contours ; i++ )
-            {
-                int contour_endi = contours[i];
-                
-                int offset = contour_starti;
-                int npts = contour_endi - contour_starti + 1;
-                
-
-                svg << "M" << points[contour_starti].x << "," << - points[contour_starti].y;
-               
-                char mode='M';
-                for ( int j = 0; j < npts; j++ )
-                {
-                    int a = j%npts + offset;
-                    int nexti = (j+1)%npts + offset;
-                    int nextnexti = (j+2)%npts + offset;
-                    
-                    long x =   points[a].x;
-                    long y = - points[a].y;
-                    long nx =  points[nexti].x;
-                    long ny = - points[nexti].y;
-                    
-                    bool this_tagbit1 = (tags[a] & 1);
-                    bool next_tagbit1 = (tags[nexti] & 1);
-                    bool nextnext_tagbit1 = (tags[ nextnexti ] & 1);
-                    bool this_isctl = !this_tagbit1;
-                    bool next_isctl = !next_tagbit1;
-                    bool nextnext_isctl = !nextnext_tagbit1;
-                    
-                    if (this_isctl && next_isctl)
-                    {
-                        // two adjacent ctl pts. adding point halfway between;
-                        // reseting x and y ";
-                        x = (x + nx) / 2;
-                        y = (y + ny) / 2;
-                        this_isctl = false;
- 
-                        //  Check if first pt in contour was a ctrl pt. moving to non-ctrl pt
-                        if(j==0)
-                        {
-                            if(mode!='M') svg << "M"; else svg << " ";
-                            svg << x << " " << y;
-                            mode='M';
-                        }
-                    }
-                    
-                    if (!this_isctl && next_isctl)
-                    {
-                        long nnx = points[nextnexti].x;
-                        long nny = - points[nextnexti].y;
-                        if(nextnext_isctl)
-                        {
-                            // two ctl pts coming. adding point halfway between
-                            // reseting nnx and nny to halfway pt
-                            nnx = (nx + nnx) / 2;
-                            nny = (ny + nny) / 2;
-                        }
-                        // produce bezier path
-                        if(mode!='Q') svg << "Q"; else svg << " ";
-                        svg << nx << " " << ny << " " << nnx << " " << nny;
-                        mode='Q';
-                    }
-                    else if (!this_isctl && !next_isctl)
-                    {
-                        // line to new point
-                        if(mode!='L') svg << "L"; else svg << " ";
-                        svg << nx << " " << ny;
-                        mode='L';
-                    }
-                    else if (this_isctl && !next_isctl)
-                    {
-                        // this is ctrl pt. skipping to
-                    }
-                }
-                
-                contour_starti = contour_endi+1;
-                svg << "Z";
-                mode='Z';
-            }
-
-            svg << "'";
-            return svg.str();
+            // the stored path has svg's y down; this header's path keeps TrueType's y up
+            font2svg::svg_compact out;
+            out.svg << "d='";
+            font2svg::play( _shape->path, out, true );
+            out.svg << "'";
+            return out.svg.str();
         }
         
         
@@ -0,0 +1,82 @@
+// font_to_svg_api.cpp - the compiled font_to_svg library
+// Copyright Don Bright 2013 <hugh.m.bright@gmail.com>
+// (zlib license, see font_to_svg.hpp)
+
+#include "font_to_svg_api.hpp"
+#include "font_to_svg.hpp"
+
+namespace font2svg {
+
+struct font::impl
+{
+	ttf_file file;
+	bool ok;
+};
+
+font::font( const std::string &filename, int face_index )
+{
+	p = new impl;
+	// ttf_file exits on a bad font, so check it can be opened first
+	FT_Library library;
+	FT_Face face;
+	FT_Init_FreeType( &library );
+	p->ok = !FT_New_Face( library, filename.c_str(), face_index, &face );
+	if (p->ok) FT_Done_Face( face );
+	FT_Done_FreeType( library );
+	if (p->ok) p->file = ttf_file( filename, face_index );
+}
+
+font::~font()
+{
+	if (p->ok) p->file.free();
+	delete p;
+}
+
+bool font::ok() const { return p->ok; }
+int font::num_faces() const { return p->ok ? p->file.face->num_faces : 0; }
+int font::num_glyphs() const { return p->ok ? p->file.face->num_glyphs : 0; }
+
+std::string font::svg( int codepoint, bool debug_drawing )
+{
+	if (!p->ok) return "";
+	FT_UInt glyph_index = FT_Get_Char_Index( p->file.face, codepoint );
+	char glyph_name[1024] = "";
+	FT_Get_Glyph_Name( p->file.face, glyph_index, glyph_name, sizeof glyph_name );
+	glyph g( p->file, codepoint, glyph_index, glyph_name );
+	if (debug_drawing)
+		return g.svgheader() + g.svgborder() + g.svgtransform() + g.axes()
+			+ g.typography_box() + g.points() + g.pointlines()
+			+ g.outline() + g.labelpts() + g.svgfooter();
+	return g.svgheader() + g.svgtransform() + g.outline() + g.svgfooter();
+}
+
+std::string font::path( int codepoint )
+{
+	if (!p->ok) return "";
+	glyph g( p->file, codepoint, FT_Get_Char_Index( p->file.face, codepoint ), "" );
+	svg_compact out;
+	g.emit( out );
+	return out.svg.str();
+}
+
+std::vector<int> font::binary_path( int codepoint )
+{
+	if (!p->ok) return std::vector<int>();
+	glyph g( p->file, codepoint, FT_Get_Char_Index( p->file.face, codepoint ), "" );
+	path_binary out;
+	g.emit( out );
+	return out.data;
+}
+
+void set_quiet( bool q )
+{
+	quiet = q;
+}
+
+std::string glyph_svg( const std::string &filename, int codepoint )
+{
+	font f( filename );
+	return f.svg( codepoint );
+}
+
+} // namespace
@@ -0,0 +1,76 @@
+// font_to_svg_api.hpp - Read Font in TrueType (R) format, write SVG
+// Copyright Don Bright 2013 <hugh.m.bright@gmail.com>
+/*
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+
+  License based on zlib license, by Jean-loup Gailly and Mark Adler
+*/
+
+/*
+
+The slim interface of the compiled font_to_svg library. It does not pull
+in FreeType or the emitters, so code that only wants svg text can include
+it from anywhere without slowing its build. Link with the 'font_to_svg'
+library target. The full header, font_to_svg.hpp, is still usable on its
+own, header-only.
+
+*/
+
+#ifndef __font_to_svg_api_h__
+#define __font_to_svg_api_h__
+
+#include <string>
+#include <vector>
+
+namespace font2svg {
+
+// a font file opened once, for converting many characters
+class font
+{
+public:
+	font( const std::string &filename, int face_index = 0 );
+	~font();
+
+	// false if the file could not be opened as a font
+	bool ok() const;
+	int num_faces() const;
+	int num_glyphs() const;
+
+	// whole svg document, as example2 (or example1 if debug_drawing)
+	std::string svg( int codepoint, bool debug_drawing = false );
+	// just the path data, compact form
+	std::string path( int codepoint );
+	// the path through the binary output policy
+	std::vector<int> binary_path( int codepoint );
+
+private:
+	struct impl;
+	impl *p;
+	font( const font & );
+	font &operator=( const font & );
+};
+
+// Stop (or restart) debug comments being printed to std::cout
+void set_quiet( bool q );
+
+// One-off conversion of one character, as example2
+std::string glyph_svg( const std::string &filename, int codepoint );
+
+} // namespace
+
+#endif
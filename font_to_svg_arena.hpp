@@ -0,0 +1,223 @@
+// font_to_svg_arena.hpp - svg output into caller provided memory
+// Copyright Don Bright 2013 <hugh.m.bright@gmail.com>
+/*
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+
+  License based on zlib license, by Jean-loup Gailly and Mark Adler
+*/
+
+/*
+
+The ordinary glyph methods build their text in stringstreams and return
+std::strings, which is a handful of heap allocations per piece. When
+converting in bulk from many threads those allocations all meet in the
+global allocator. Here the same svg text is written straight into a
+std::pmr::string, so all of it can come from an 'arena' (a monotonic
+memory resource) that belongs to one thread and one batch, and is thrown
+away in one step with release().
+
+release() keeps the memory: when a batch needed more than the arena
+held, the arena is remade as one block of the size that batch needed.
+So once it has seen its largest batch, converting takes nothing more
+from the global allocator. It also never gives memory back until it
+goes away, so a one-off huge batch is held on to.
+
+The arena counts what it hands out, and what it takes from upstream, so
+a test can check that a batch really stays inside it (font2svg_regress
+does).
+
+*/
+
+#ifndef __font_to_svg_arena_h__
+#define __font_to_svg_arena_h__
+
+#include "font_to_svg.hpp"
+#include <memory_resource>
+#include <charconv>
+#include <cstddef>
+#include <optional>
+
+namespace font2svg {
+
+/* Monotonic memory for one batch. Allocations are counted; memory is only
+given back by release() (or when the arena goes away). */
+class arena : public std::pmr::memory_resource
+{
+public:
+	arena( size_t initial_size = 64*1024,
+		std::pmr::memory_resource *upstream = std::pmr::get_default_resource() )
+		: counted( upstream ), initial( initial_size ), keep( NULL ), keep_size( 0 ), allocs( 0 ), bytes( 0 )
+	{
+		mono.emplace( initial, &counted );
+	}
+
+	~arena()
+	{
+		mono.reset();
+		if (keep) counted.deallocate( keep, keep_size, alignof(std::max_align_t) );
+	}
+
+	/* Start the next batch. If this one outgrew the kept block, the block
+	grows by what was taken on top of it, so the same batch again fits. */
+	void release()
+	{
+		size_t grown = counted.bytes;
+		mono.reset(); // gives its blocks back upstream
+		if (grown) {
+			if (keep) counted.deallocate( keep, keep_size, alignof(std::max_align_t) );
+			keep_size += grown;
+			keep = counted.allocate( keep_size, alignof(std::max_align_t) );
+		}
+		counted.bytes = 0;
+		if (keep) mono.emplace( keep, keep_size, &counted );
+		else mono.emplace( initial, &counted );
+		allocs = bytes = 0;
+	}
+
+	// allocations served since the last release(), and their total size
+	size_t allocations() const { return allocs; }
+	size_t allocated_bytes() const { return bytes; }
+	// blocks the arena itself has taken from the upstream resource, ever
+	size_t upstream_allocations() const { return counted.allocs; }
+	// size of the block kept between batches
+	size_t kept_bytes() const { return keep_size; }
+
+private:
+	// forwards to upstream, counting
+	struct counter : public std::pmr::memory_resource
+	{
+		std::pmr::memory_resource *up;
+		size_t allocs, bytes;
+		counter( std::pmr::memory_resource *u ) : up( u ), allocs( 0 ), bytes( 0 ) {}
+		void *do_allocate( size_t n, size_t align ) { allocs++; bytes += n; return up->allocate( n, align ); }
+		void do_deallocate( void *p, size_t n, size_t align ) { up->deallocate( p, n, align ); }
+		bool do_is_equal( const std::pmr::memory_resource &o ) const noexcept { return this == &o; }
+	};
+	counter counted;
+	size_t initial;
+	void *keep;
+	size_t keep_size;
+	std::optional<std::pmr::monotonic_buffer_resource> mono;
+	size_t allocs, bytes;
+
+	arena( const arena & );
+	arena &operator=( const arena & );
+
+	void *do_allocate( size_t n, size_t align )
+	{
+		allocs++;
+		bytes += n;
+		return mono->allocate( n, align );
+	}
+	void do_deallocate( void *p, size_t n, size_t align ) { mono->deallocate( p, n, align ); }
+	bool do_is_equal( const std::pmr::memory_resource &o ) const noexcept { return this == &o; }
+};
+
+// append text and numbers to a pmr string without going through streams
+struct text
+{
+	std::pmr::string &s;
+	text( std::pmr::string &str ) : s( str ) {}
+	text &operator<<( const char *c ) { s += c; return *this; }
+	text &operator<<( long n )
+	{
+		char buf[24];
+		std::to_chars_result r = std::to_chars( buf, buf + sizeof buf, n );
+		s.append( buf, r.ptr );
+		return *this;
+	}
+};
+
+// Output policy: svg path data as svg_verbose writes it, into a pmr string
+struct svg_verbose_text
+{
+	text svg;
+	svg_verbose_text( std::pmr::string &s ) : svg( s ) {}
+	void start( long x, long y ) { svg << "\n M " << x << "," << y << "\n"; }
+	void move( long x, long y ) { svg << " M " << x << "," << y << "\n"; }
+	void line( long x, long y ) { svg << " L " << x << "," << y << "\n"; }
+	void quad( long cx, long cy, long x, long y ) { svg << " Q " << cx << "," << cy << " " << x << "," << y << "\n"; }
+	void close() { svg << " Z\n"; }
+};
+
+// The pieces of glyph's svg output, appended to 'out'.
+
+inline void svgheader( glyph &g, std::pmr::string &out )
+{
+	text(out) << "\n<svg width='" << (long)g.bbwidth << "px'"
+		<< " height='" << (long)g.bbheight << "px'"
+		<< " xmlns='http://www.w3.org/2000/svg' version='1.1'>";
+}
+
+inline void svgtransform( glyph &g, std::pmr::string &out )
+{
+	text(out) << "\n\n <!-- make sure glyph is visible within svg window -->"
+		<< "\n <g fill-rule='nonzero' "
+		<< " transform='translate(" << 100L << " " << (long)(int)(g.gm.horiBearingY + g.gm.vertBearingY + 100) << ")'"
+		<< ">";
+}
+
+inline void outline( glyph &g, std::pmr::string &out )
+{
+	if (g.ftoutline.n_points==0) { out += "<!-- font had 0 points -->"; return; }
+	if (g.ftoutline.n_contours==0) { out += "<!-- font had 0 contours -->"; return; }
+	out += "\n\n  <!-- draw actual outline using lines and Bezier curves-->"
+		"\n  <path fill='black' stroke='black'"
+		" fill-opacity='0.45' "
+		" stroke-width='2' "
+		" d='";
+	svg_verbose_text path( out );
+	g.emit( path );
+	out += "\n  '/>";
+}
+
+inline void svgfooter( glyph &, std::pmr::string &out )
+{
+	out += "\n </g>\n</svg>\n";
+}
+
+// The same document as svgheader() + svgtransform() + outline() + svgfooter()
+inline std::pmr::string document( glyph &g, std::pmr::memory_resource *mr )
+{
+	FONT2SVG_TIME( format );
+	std::pmr::string out( mr );
+	out.reserve( 64 + 32 * g.ftoutline.n_points );
+	svgheader( g, out );
+	svgtransform( g, out );
+	outline( g, out );
+	svgfooter( g, out );
+	return out;
+}
+
+/* Convert a batch of characters with all output, and the vector holding
+it, in 'mr'. The results live until 'mr' is released. */
+inline std::pmr::vector<std::pmr::string> convert_batch( ttf_file &file,
+	const std::vector<int> &codepoints, std::pmr::memory_resource *mr )
+{
+	std::pmr::vector<std::pmr::string> result( mr );
+	result.reserve( codepoints.size() );
+	for ( size_t i = 0 ; i < codepoints.size() ; i++ ) {
+		glyph g( file, codepoints[i], FT_Get_Char_Index( file.face, codepoints[i] ), "", mr );
+		result.push_back( document( g, mr ) );
+	}
+	return result;
+}
+
+} // namespace
+
+#endif
@@ -0,0 +1,367 @@
+// font_to_svg_color.hpp - color glyphs: COLR/CPAL layers, sbix and CBDT images
+// Copyright Don Bright 2013 <hugh.m.bright@gmail.com>
+/*
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+
+  License based on zlib license, by Jean-loup Gailly and Mark Adler
+*/
+
+/*
+
+Emoji and icon fonts draw their glyphs in color, in one of three ways:
+
+ COLR v0 + CPAL  a glyph is a stack of ordinary outline glyphs ('layers'),
+                 each filled with one color of a palette
+ sbix            a picture (PNG) per glyph, for each of a few sizes
+                 ('strikes'), as in Apple's fonts
+ CBDT + CBLC     the same idea, as in Google's Noto Color Emoji
+
+color_font writes any of them as an svg document. COLR layers become
+<path>s in a <defs>, drawn by one <use> per layer, in the layer's color.
+The same layer outlines turn up under many emoji, so each is converted
+once and kept for as long as the color_font. Pictures are copied out of
+the font as they are, base64 encoded, into an <image>. A glyph with none
+of these gets its plain outline, as from glyph::outline().
+
+COLR needs FreeType 2.10 or later; with older versions only the pictures
+are found. A color_font, like the face it reads, is for one thread.
+
+ COLR: https://learn.microsoft.com/typography/opentype/spec/colr
+ CPAL: https://learn.microsoft.com/typography/opentype/spec/cpal
+ sbix: https://learn.microsoft.com/typography/opentype/spec/sbix
+ CBLC: https://learn.microsoft.com/typography/opentype/spec/cblc
+ CBDT: https://learn.microsoft.com/typography/opentype/spec/cbdt
+
+*/
+
+#ifndef __font_to_svg_color_h__
+#define __font_to_svg_color_h__
+
+#include "font_to_svg.hpp"
+#include <iomanip>
+#include <map>
+#include <set>
+#include <cstdio>
+#include <cstring>
+
+#if FREETYPE_MAJOR > 2 || (FREETYPE_MAJOR == 2 && FREETYPE_MINOR >= 10)
+#include FT_COLOR_H
+#define FONT2SVG_COLR 1
+#endif
+
+namespace font2svg {
+
+inline std::string base64( const unsigned char *data, size_t n )
+{
+	const char *digits = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+	std::string out;
+	out.reserve( (n + 2) / 3 * 4 );
+	for ( size_t i = 0 ; i < n ; i += 3 ) {
+		unsigned v = data[i] << 16;
+		if (i + 1 < n) v |= data[i+1] << 8;
+		if (i + 2 < n) v |= data[i+2];
+		out += digits[ (v >> 18) & 63 ];
+		out += digits[ (v >> 12) & 63 ];
+		out += i + 1 < n ? digits[ (v >> 6) & 63 ] : '=';
+		out += i + 2 < n ? digits[ v & 63 ] : '=';
+	}
+	return out;
+}
+
+/* A picture stored in the font for one glyph. 'data' points into the
+color_font's copy of the table. Position and size are in font units,
+y down as in svg, from the glyph's origin on the baseline. */
+struct color_image
+{
+	const unsigned char *data;
+	size_t size;
+	double x, y, width, height;
+};
+
+class color_font
+{
+public:
+	ttf_file file;
+
+	/* 'palette' picks the CPAL palette. 'ppem' picks the picture size:
+	the smallest strike of at least that many pixels per em, or with 0,
+	the biggest one. */
+	color_font( ttf_file &f, int palette = 0, int ppem = 0 )
+	{
+		file = f;
+		FT_Face face = file.face;
+		upem = face->units_per_EM ? face->units_per_EM : 1000;
+		colors = NULL;
+		n_colors = 0;
+#ifdef FONT2SVG_COLR
+		FT_Palette_Data pd;
+		if (!FT_Palette_Data_Get( face, &pd ) && palette >= 0 && palette < pd.num_palettes
+			&& !FT_Palette_Select( face, palette, &colors ))
+			n_colors = pd.num_palette_entries;
+#endif
+
+		// sbix: version, flags, number of strikes, offsets to the strikes
+		sbix = load_table( face, TTAG_sbix );
+		std::vector< std::pair<unsigned,size_t> > found;
+		unsigned n = has( sbix, 4, 4 ) ? read_u32( &sbix[4] ) : 0;
+		for ( unsigned i = 0 ; i < n && has( sbix, 8 + 4*i, 4 ) ; i++ ) {
+			size_t at = read_u32( &sbix[8 + 4*i] );
+			if (has( sbix, at, 4 )) found.push_back( std::make_pair( read_u16( &sbix[at] ), at ) );
+		}
+		sbix_strikes = by_preference( found, ppem );
+
+		// CBLC: version, number of sizes, then 48 byte size records
+		cblc = load_table( face, TTAG_CBLC );
+		cbdt = load_table( face, TTAG_CBDT );
+		found.clear();
+		n = has( cblc, 4, 4 ) && cbdt.size() ? read_u32( &cblc[4] ) : 0;
+		for ( unsigned i = 0 ; i < n && has( cblc, 8 + 48*i, 48 ) ; i++ )
+			found.push_back( std::make_pair( cblc[8 + 48*i + 45], 8 + 48*i ) );
+		cblc_sizes = by_preference( found, ppem );
+	}
+
+	// number of layer outlines converted so far
+	size_t cached() const { return paths.size(); }
+
+	// The font's own path data for one glyph, converted on first use.
+	const std::string &layer_path( FT_UInt gid )
+	{
+		std::map<FT_UInt, std::string>::iterator it = paths.find( gid );
+		if (it != paths.end()) {
+			FONT2SVG_COUNT( cache_hits, 1 );
+			return it->second;
+		}
+		FONT2SVG_COUNT( cache_misses, 1 );
+		glyph g( file, 0, gid, "" );
+		svg_compact out;
+		g.emit( out );
+		return paths[gid] = out.svg.str();
+	}
+
+	/* COLR layers of a glyph: a <defs> of the layer outlines and a <use>
+	for each layer, bottom first. Empty if the glyph has no layers. */
+	std::string layers( FT_UInt gid )
+	{
+		text_stream defs, uses;
+#ifdef FONT2SVG_COLR
+		FT_UInt layer;
+		FT_UInt color;
+		FT_LayerIterator iterator;
+		iterator.p = NULL;
+		std::set<FT_UInt> defined;
+		while (FT_Get_Color_Glyph_Layer( file.face, gid, &layer, &color, &iterator )) {
+			if (defined.insert( layer ).second)
+				defs << "\n   <path id='l" << layer << "' d='" << layer_path( layer ) << "'/>";
+			uses << "\n  <use xlink:href='#l" << layer << "'" << fill( color ) << "/>";
+		}
+#endif
+		if (uses.str().empty()) return "";
+		return "\n\n  <!-- color layers -->\n  <defs>" + defs.str() + "\n  </defs>" + uses.str();
+	}
+
+	// The picture for a glyph, from sbix or else CBDT. False if none.
+	bool image( FT_UInt gid, color_image &img )
+	{
+		if (gid >= (FT_UInt)file.face->num_glyphs) return false;
+		for ( size_t i = 0 ; i < sbix_strikes.size() ; i++ )
+			if (sbix_image( sbix_strikes[i], gid, img, 0 )) return true;
+		for ( size_t i = 0 ; i < cblc_sizes.size() ; i++ )
+			if (cbdt_image( cblc_sizes[i], gid, img )) return true;
+		return false;
+	}
+
+	// An svg document for one character, in color where the font has it.
+	std::string document( int codepoint )
+	{
+		return document( codepoint, FT_Get_Char_Index( file.face, codepoint ) );
+	}
+
+	// The same, for a glyph looked up already (or without a codepoint)
+	std::string document( int codepoint, FT_UInt gid )
+	{
+		FONT2SVG_TIME( format );
+		glyph g( file, codepoint, gid, "" );
+		text_stream out;
+		out << "\n<svg width='" << g.bbwidth << "px'"
+			<< " height='" << g.bbheight << "px'"
+			<< " xmlns='http://www.w3.org/2000/svg'"
+			<< " xmlns:xlink='http://www.w3.org/1999/xlink' version='1.1'>";
+		std::string colored = layers( gid );
+		color_image img;
+		if (colored.empty() && image( gid, img )) {
+			// no outline to take bearings from: the picture's top goes 100 down
+			out << "\n\n <g transform='translate(" << 100 << " " << 100 - img.y << ")'>"
+				<< "\n  <image x='" << img.x << "' y='" << img.y << "'"
+				<< " width='" << img.width << "' height='" << img.height << "'"
+				<< " xlink:href='data:image/png;base64," << base64( img.data, img.size ) << "'/>";
+		} else {
+			out << g.svgtransform() << (colored.size() ? colored : g.outline());
+		}
+		out << g.svgfooter();
+		return out.str();
+	}
+
+private:
+	unsigned upem;
+	FT_Color *colors;
+	unsigned n_colors;
+	std::map<FT_UInt, std::string> paths;
+	std::vector<unsigned char> sbix, cblc, cbdt;
+	std::vector<size_t> sbix_strikes, cblc_sizes; // offsets, best first
+
+	static bool has( const std::vector<unsigned char> &t, size_t at, size_t n )
+	{
+		return at <= t.size() && n <= t.size() - at;
+	}
+
+	// (ppem, offset) pairs -> offsets, the one 'ppem' asks for first
+	static std::vector<size_t> by_preference( std::vector< std::pair<unsigned,size_t> > s, int ppem )
+	{
+		std::sort( s.begin(), s.end() );
+		std::vector<size_t> order;
+		for ( size_t i = 0 ; i < s.size() ; i++ )
+			if (ppem > 0 && s[i].first >= (unsigned)ppem) order.push_back( s[i].second );
+		for ( size_t i = s.size() ; i-- > 0 ; )
+			if (!(ppem > 0 && s[i].first >= (unsigned)ppem)) order.push_back( s[i].second );
+		return order;
+	}
+
+	std::string fill( FT_UInt color )
+	{
+		if (color == 0xFFFF || color >= n_colors) return " fill='currentColor'";
+		char buf[64];
+		const FT_Color &c = colors[color];
+		snprintf( buf, sizeof buf, " fill='#%02x%02x%02x'", c.red, c.green, c.blue );
+		std::string s( buf );
+		if (c.alpha != 255) {
+			// a stream in the "C" locale: printf's %g would follow LC_NUMERIC
+			text_stream opacity;
+			opacity << " fill-opacity='" << std::setprecision( 3 ) << c.alpha / 255.0 << "'";
+			s += opacity.str();
+		}
+		return s;
+	}
+
+	// PNG size, from its header
+	static bool png_size( const unsigned char *p, size_t n, unsigned &w, unsigned &h )
+	{
+		if (n < 24 || memcmp( p, "\x89PNG", 4 )) return false;
+		w = read_u32( p + 16 );
+		h = read_u32( p + 20 );
+		return true;
+	}
+
+	/* sbix strike: ppem, ppi, offsets to each glyph's data. Glyph data:
+	origin x, y (pixels, to the picture's bottom left), type, picture.
+	Type 'dupe' means: the same picture as the glyph id that follows. */
+	bool sbix_image( size_t strike, FT_UInt gid, color_image &img, int depth )
+	{
+		size_t at = strike + 4 + 4 * (size_t)gid;
+		if (depth > 1 || !has( sbix, at, 8 )) return false;
+		size_t start = strike + read_u32( &sbix[at] ), end = strike + read_u32( &sbix[at+4] );
+		if (end < start + 8 || !has( sbix, start, end - start )) return false;
+		const unsigned char *g = &sbix[start];
+		if (!memcmp( g + 4, "dupe", 4 ))
+			return end - start >= 10 && sbix_image( strike, read_u16( g + 8 ), img, depth + 1 );
+		unsigned w, h;
+		if (memcmp( g + 4, "png ", 4 ) || !png_size( g + 8, end - start - 8, w, h )) return false;
+		double scale = double( upem ) / std::max( 1, (int)read_u16( &sbix[strike] ) );
+		img.data = g + 8;
+		img.size = end - start - 8;
+		img.x = (short)read_u16( g ) * scale;
+		img.y = -((short)read_u16( g + 2 ) + (double)h) * scale;
+		img.width = w * scale;
+		img.height = h * scale;
+		return true;
+	}
+
+	/* CBLC size record -> index subtables -> offset of the glyph's data in
+	CBDT, in one of five index formats. The data holds the picture's
+	metrics (unless the index does) and the PNG. */
+	bool cbdt_image( size_t size, FT_UInt gid, color_image &img )
+	{
+		const unsigned char *s = &cblc[size];
+		if (gid < read_u16( s + 40 ) || gid > read_u16( s + 42 )) return false;
+		size_t array = read_u32( s );
+		unsigned subtables = read_u32( s + 8 );
+		for ( unsigned k = 0 ; k < subtables ; k++ ) {
+			size_t at = array + 8 * (size_t)k;
+			if (!has( cblc, at, 8 )) return false;
+			unsigned first = read_u16( &cblc[at] ), last = read_u16( &cblc[at+2] );
+			if (gid < first || gid > last) continue;
+			size_t sub = array + read_u32( &cblc[at+4] );
+			if (!has( cblc, sub, 8 )) return false;
+			unsigned index_format = read_u16( &cblc[sub] ), image_format = read_u16( &cblc[sub+2] );
+			size_t data = read_u32( &cblc[sub+4] ), body = sub + 8;
+			size_t offset = 0, length = 0;
+			const unsigned char *big = NULL; // metrics shared by the subtable
+			unsigned i = gid - first;
+			if (index_format == 1 && has( cblc, body + 4*(size_t)i, 8 )) {
+				offset = read_u32( &cblc[body + 4*i] );
+				length = read_u32( &cblc[body + 4*i + 4] ) - offset;
+			} else if (index_format == 3 && has( cblc, body + 2*(size_t)i, 4 )) {
+				offset = read_u16( &cblc[body + 2*i] );
+				length = read_u16( &cblc[body + 2*i + 2] ) - offset;
+			} else if (index_format == 2 && has( cblc, body, 12 )) {
+				length = read_u32( &cblc[body] );
+				offset = length * i;
+				big = &cblc[body + 4];
+			} else if (index_format == 4 && has( cblc, body, 4 )) {
+				unsigned n = read_u32( &cblc[body] );
+				for ( unsigned j = 0 ; j < n && has( cblc, body + 4 + 4*(size_t)j, 8 ) ; j++ ) {
+					if (read_u16( &cblc[body + 4 + 4*j] ) != gid) continue;
+					offset = read_u16( &cblc[body + 6 + 4*j] );
+					length = read_u16( &cblc[body + 10 + 4*j] ) - offset;
+					break;
+				}
+			} else if (index_format == 5 && has( cblc, body, 16 )) {
+				unsigned n = read_u32( &cblc[body + 12] );
+				for ( unsigned j = 0 ; j < n && has( cblc, body + 16 + 2*(size_t)j, 2 ) ; j++ ) {
+					if (read_u16( &cblc[body + 16 + 2*j] ) != gid) continue;
+					length = read_u32( &cblc[body] );
+					offset = length * j;
+					big = &cblc[body + 4];
+					break;
+				}
+			}
+			if (length == 0 || length > 0x7fffffff || !has( cbdt, data + offset, length )) return false;
+			const unsigned char *p = &cbdt[data + offset], *metrics = NULL;
+			size_t skip = 0;
+			if (image_format == 17) { metrics = p; skip = 5; }
+			else if (image_format == 18) { metrics = p; skip = 8; }
+			else if (image_format == 19) { metrics = big; skip = 0; }
+			if (!metrics || length < skip + 4) return false;
+			size_t png = read_u32( p + skip );
+			if (png > length - skip - 4) return false;
+			// small and big metrics start alike: height, width, bearing x, bearing y
+			double scale = double( upem ) / std::max( 1, (int)cblc[size + 45] );
+			img.data = p + skip + 4;
+			img.size = png;
+			img.x = (signed char)metrics[2] * scale;
+			img.y = -(signed char)metrics[3] * scale;
+			img.width = metrics[1] * scale;
+			img.height = metrics[0] * scale;
+			return true;
+		}
+		return false;
+	}
+};
+
+} // namespace
+
+#endif
@@ -0,0 +1,245 @@
+// font_to_svg_incremental.hpp - only reconvert glyphs that changed
+// Copyright Don Bright 2013 <hugh.m.bright@gmail.com>
+/*
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+
+  License based on zlib license, by Jean-loup Gailly and Mark Adler
+*/
+
+/*
+
+When a font is rebuilt usually only a few glyphs really change. Each
+glyph gets a 64 bit hash of everything its svg output depends on:
+
+ - its raw 'glyf' data, and that of the glyphs it is built from (composites)
+ - its 'hmtx' / 'vmtx' entries
+ - the face-wide numbers used for every glyph (bounding box in 'head',
+   'hhea', 'vhea', 'OS/2'), but not the checksum or dates in 'head',
+   which change on every build
+ - the conversion options, given by the caller as a string
+
+Fonts without a 'glyf' table (CFF outlines) have their glyph loaded
+through FreeType and the unscaled outline and metrics hashed instead.
+
+A manifest file remembers 'codepoint hash output' for the last run, and
+needs_update() says which glyphs have to be written again. Glyphs asked
+for by id rather than by codepoint are remembered as 'g<id> hash output'.
+
+ glyf: https://learn.microsoft.com/typography/opentype/spec/glyf
+ loca: https://learn.microsoft.com/typography/opentype/spec/loca
+
+*/
+
+#ifndef __font_to_svg_incremental_h__
+#define __font_to_svg_incremental_h__
+
+#include "font_to_svg.hpp"
+#include <fstream>
+#include <map>
+
+namespace font2svg {
+
+// FNV-1a, 64 bit
+inline uint64_t hash_bytes( const void *data, size_t n, uint64_t h = 14695981039346656037ULL )
+{
+	const unsigned char *p = (const unsigned char *)data;
+	for ( size_t i = 0 ; i < n ; i++ ) {
+		h ^= p[i];
+		h *= 1099511628211ULL;
+	}
+	return h;
+}
+
+/* The raw tables the hashes are made from. Read once per font; after that
+hashing 'glyf' fonts does not touch FreeType, so one set of tables can be
+shared by any number of threads. */
+class glyph_hasher
+{
+public:
+	glyph_hasher( ttf_file &f, std::string options )
+	{
+		face = f.face;
+		glyf = load_table( face, TTAG_glyf );
+		std::vector<unsigned char> loca_raw = load_table( face, TTAG_loca );
+		std::vector<unsigned char> head = load_table( face, TTAG_head );
+		hmtx = load_table( face, TTAG_hmtx );
+		vmtx = load_table( face, TTAG_vmtx );
+		std::vector<unsigned char> hhea = load_table( face, TTAG_hhea );
+		std::vector<unsigned char> vhea = load_table( face, TTAG_vhea );
+		std::vector<unsigned char> os2 = load_table( face, TTAG_OS2 );
+
+		// head: indexToLocFormat at 50, bounding box at 36..44
+		bool long_loca = head.size() > 51 && read_u16( &head[50] ) == 1;
+		if (glyf.size() && loca_raw.size()) {
+			size_t entries = loca_raw.size() / (long_loca ? 4 : 2);
+			for ( size_t i = 0 ; i < entries ; i++ )
+				loca.push_back( long_loca ? read_u32( &loca_raw[i*4] ) : 2 * read_u16( &loca_raw[i*2] ) );
+		}
+		hmetrics = hhea.size() >= 36 ? read_u16( &hhea[34] ) : 0;
+		vmetrics = vhea.size() >= 36 ? read_u16( &vhea[34] ) : 0;
+
+		base = hash_bytes( options.data(), options.size() );
+		if (head.size() >= 44) base = hash_bytes( &head[36], 8, base );
+		else base = hash_bytes( &face->bbox, sizeof face->bbox, base );
+		if (hhea.size()) base = hash_bytes( &hhea[0], hhea.size(), base );
+		if (vhea.size()) base = hash_bytes( &vhea[0], vhea.size(), base );
+		if (os2.size()) base = hash_bytes( &os2[0], os2.size(), base );
+	}
+
+	// true if hashing works from the raw tables (no FreeType calls)
+	bool raw() const { return loca.size() > 1; }
+
+	/* Hash of one glyph. For fonts that are not raw(), the glyph is loaded
+	through 'f', which must be a face of the same font used by this thread
+	only (or the face given to the constructor, from one thread). */
+	uint64_t hash( FT_UInt gid, FT_Face f = NULL ) const
+	{
+		uint64_t h = base;
+		h = hash_metrics( gid, h );
+		if (raw()) return hash_glyf( gid, h, 0 );
+
+		if (!f) f = face;
+		if (FT_Load_Glyph( f, gid, FT_LOAD_NO_SCALE )) return h;
+		FT_Outline &o = f->glyph->outline;
+		h = hash_bytes( &f->glyph->metrics, sizeof f->glyph->metrics, h );
+		if (o.n_points) {
+			h = hash_bytes( o.points, o.n_points * sizeof(FT_Vector), h );
+			h = hash_bytes( o.tags, o.n_points, h );
+		}
+		if (o.n_contours) h = hash_bytes( o.contours, o.n_contours * sizeof(short), h );
+		return h;
+	}
+
+private:
+	FT_Face face;
+	std::vector<unsigned char> glyf, hmtx, vmtx;
+	std::vector<uint32_t> loca;
+	unsigned hmetrics, vmetrics;
+	uint64_t base;
+
+	// long metric (4 bytes) for the first n glyphs, then bearings only (2 bytes)
+	static uint64_t hash_mtx( const std::vector<unsigned char> &mtx, unsigned n, FT_UInt gid, uint64_t h )
+	{
+		if (n == 0) return h;
+		size_t at = gid < n ? gid * 4 : (n-1) * 4;
+		if (at + 4 <= mtx.size()) h = hash_bytes( &mtx[at], 4, h );
+		if (gid >= n) {
+			at = n * 4 + (gid - n) * 2;
+			if (at + 2 <= mtx.size()) h = hash_bytes( &mtx[at], 2, h );
+		}
+		return h;
+	}
+
+	uint64_t hash_metrics( FT_UInt gid, uint64_t h ) const
+	{
+		h = hash_mtx( hmtx, hmetrics, gid, h );
+		return hash_mtx( vmtx, vmetrics, gid, h );
+	}
+
+	uint64_t hash_glyf( FT_UInt gid, uint64_t h, int depth ) const
+	{
+		if (gid + 1 >= loca.size() || depth > 16) return h;
+		uint32_t start = loca[gid], end = loca[gid+1];
+		if (end <= start || end > glyf.size()) return hash_bytes( "empty", 5, h );
+		const unsigned char *g = &glyf[start];
+		h = hash_bytes( g, end - start, h );
+		if ((short)read_u16( g ) >= 0) return h;
+
+		// composite: walk the component records, hash each component too
+		enum { ARG_WORDS = 0x1, HAVE_SCALE = 0x8, MORE = 0x20, XY_SCALE = 0x40, TWO_BY_TWO = 0x80 };
+		size_t at = 10;
+		unsigned flags;
+		do {
+			if (start + at + 4 > end) break;
+			flags = read_u16( g + at );
+			FT_UInt component = read_u16( g + at + 2 );
+			h = hash_glyf( component, h, depth + 1 );
+			h = hash_metrics( component, h );
+			at += 4 + ((flags & ARG_WORDS) ? 4 : 2);
+			if (flags & HAVE_SCALE) at += 2;
+			else if (flags & XY_SCALE) at += 4;
+			else if (flags & TWO_BY_TWO) at += 8;
+		} while (flags & MORE);
+		return h;
+	}
+};
+
+/* What was written last time: per codepoint, the glyph hash and the
+output file. Stored as text, one 'codepoint hash output' per line. */
+class incremental_manifest
+{
+public:
+	struct record
+	{
+		uint64_t hash;
+		std::string output;
+	};
+	std::map<int, record> records; // by codepoint, or glyph_key( gid )
+
+	// glyph ids are kept below zero, out of the way of codepoints
+	static int glyph_key( long gid ) { return -1 - (int)gid; }
+
+	bool load( std::string fname )
+	{
+		std::ifstream in( fname.c_str() );
+		if (!in) return false;
+		std::string line;
+		while (std::getline( in, line )) {
+			std::stringstream ls( line );
+			std::string cp, hash;
+			record r;
+			if (!(ls >> cp >> hash)) continue;
+			std::getline( ls >> std::ws, r.output );
+			r.hash = strtoull( hash.c_str(), NULL, 16 );
+			if (cp[0] == 'g') records[ glyph_key( strtol( cp.c_str() + 1, NULL, 0 ) ) ] = r;
+			else records[ strtol( cp.c_str(), NULL, 0 ) ] = r;
+		}
+		return true;
+	}
+
+	bool save( std::string fname )
+	{
+		std::ofstream out( fname.c_str() );
+		out.imbue( std::locale::classic() );
+		for ( std::map<int, record>::iterator it = records.begin() ; it != records.end() ; ++it ) {
+			if (it->first < 0) out << "g" << -1 - it->first;
+			else out << "0x" << std::hex << it->first;
+			out << " " << std::hex << it->second.hash << std::dec << " " << it->second.output << "\n";
+		}
+		return out.good();
+	}
+
+	// true if the glyph is new, its hash changed, or it goes somewhere else
+	bool needs_update( int codepoint, uint64_t hash, const std::string &output ) const
+	{
+		std::map<int, record>::const_iterator it = records.find( codepoint );
+		return it == records.end() || it->second.hash != hash || it->second.output != output;
+	}
+
+	void update( int codepoint, uint64_t hash, const std::string &output )
+	{
+		record r;
+		r.hash = hash;
+		r.output = output;
+		records[codepoint] = r;
+	}
+};
+
+} // namespace
+
+#endif
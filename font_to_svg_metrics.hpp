@@ -0,0 +1,338 @@
+// font_to_svg_metrics.hpp - advances, bearings and kerning of a whole font
+// Copyright Don Bright 2013 <hugh.m.bright@gmail.com>
+/*
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+
+  License based on zlib license, by Jean-loup Gailly and Mark Adler
+*/
+
+/*
+
+Text layout needs the metrics of the glyphs and the kerning pairs, not
+their outlines. read_metrics() makes a table of them indexed by glyph id,
+in font units, with the same numbers FT_Load_Glyph( FT_LOAD_NO_SCALE )
+puts in FT_Glyph_Metrics:
+
+ advance         horiAdvance      from 'hmtx'
+ bearing_x       horiBearingX     xMin of the glyph's points
+ bearing_y       horiBearingY     yMax of the glyph's points
+ vert_advance    vertAdvance      from 'vmtx', or made up as FreeType does,
+ vert_bearing_y  vertBearingY     from the 'OS/2' (or 'hhea') ascender and
+                                  descender and the glyph height
+ width, height   width, height    size of the glyph box
+
+For TrueType fonts all of it comes straight from the tables: the glyph
+box is found from the point coordinates in 'glyf', without building an
+outline. Composite glyphs, fonts with CFF
+outlines, and variable fonts (whose metrics depend on the instance) load
+the glyph through FreeType instead, which is slower but still doesn't
+touch the outline.
+
+Kerning is read from format 0 subtables of the 'kern' table, the same
+ones FT_Get_Kerning() uses. Kerning in 'GPOS' is not read.
+
+ hmtx: https://learn.microsoft.com/typography/opentype/spec/hmtx
+ kern: https://learn.microsoft.com/typography/opentype/spec/kern
+
+*/
+
+#ifndef __font_to_svg_metrics_h__
+#define __font_to_svg_metrics_h__
+
+#include "font_to_svg.hpp"
+#include <map>
+#include <cstdlib>
+
+namespace font2svg {
+
+struct metrics_entry
+{
+	int32_t advance, bearing_x, bearing_y, vert_advance, vert_bearing_y, width, height;
+};
+
+struct kern_pair
+{
+	uint16_t left, right;
+	int16_t value;
+};
+
+struct metrics_table
+{
+	int units_per_em;
+	bool from_tables; // false if glyphs were loaded through FreeType
+	std::vector<metrics_entry> glyphs;
+	std::vector<kern_pair> kerning; // sorted by (left, right)
+
+	// kerning between two glyph ids, 0 if none
+	int kern( FT_UInt left, FT_UInt right ) const
+	{
+		uint32_t key = (left << 16) | right;
+		size_t lo = 0, hi = kerning.size();
+		while (lo < hi) {
+			size_t mid = (lo + hi) / 2;
+			uint32_t k = (kerning[mid].left << 16) | kerning[mid].right;
+			if (k == key) return kerning[mid].value;
+			if (k < key) lo = mid + 1; else hi = mid;
+		}
+		return 0;
+	}
+};
+
+namespace metrics_detail {
+
+// advance and bearing of one glyph from an hmtx/vmtx style table
+inline void long_metric( const std::vector<unsigned char> &mtx, unsigned n, FT_UInt gid, int &advance, int &bearing )
+{
+	advance = bearing = 0;
+	if (n == 0) return;
+	size_t at = (gid < n ? gid : n - 1) * 4;
+	if (at + 4 <= mtx.size()) {
+		advance = read_u16( &mtx[at] );
+		bearing = (int16_t)read_u16( &mtx[at+2] );
+	}
+	if (gid >= n) {
+		at = n * 4 + (gid - n) * 2;
+		bearing = at + 2 <= mtx.size() ? (int16_t)read_u16( &mtx[at] ) : 0;
+	}
+}
+
+inline void read_kern( FT_Face face, std::vector<kern_pair> &pairs )
+{
+	std::vector<unsigned char> kern = load_table( face, TTAG_kern );
+	if (kern.size() < 4 || read_u16( &kern[0] ) != 0) return; // not the OpenType version
+	// pairs in more than one subtable add up, unless the later one overrides
+	std::map<uint32_t, int> sum;
+	unsigned tables = read_u16( &kern[2] );
+	size_t at = 4;
+	for ( unsigned t = 0 ; t < tables && at + 6 <= kern.size() ; t++ ) {
+		unsigned length = read_u16( &kern[at+2] );
+		unsigned coverage = read_u16( &kern[at+4] );
+		// horizontal, not minimum values, not cross-stream, format 0
+		if ((coverage & 0x7) == 1 && (coverage >> 8) == 0 && at + 14 <= kern.size()) {
+			bool override = coverage & 0x8;
+			unsigned n = read_u16( &kern[at+6] );
+			for ( size_t p = at + 14 ; n-- && p + 6 <= kern.size() ; p += 6 ) {
+				uint32_t key = read_u32( &kern[p] );
+				int value = (int16_t)read_u16( &kern[p+4] );
+				if (override) sum[key] = value; else sum[key] += value;
+			}
+		}
+		if (length < 6) break;
+		at += length;
+	}
+	for ( std::map<uint32_t, int>::iterator it = sum.begin() ; it != sum.end() ; ++it ) {
+		kern_pair k;
+		k.left = it->first >> 16;
+		k.right = it->first & 0xFFFF;
+		k.value = it->second;
+		pairs.push_back( k );
+	}
+}
+
+/* Box around the points of a simple glyph, read from its flags and
+coordinate deltas. False if the data is cut short. */
+inline bool point_box( const unsigned char *g, size_t len, int &xmin, int &ymin, int &xmax, int &ymax )
+{
+	enum { ON_CURVE = 0x1, X_SHORT = 0x2, Y_SHORT = 0x4, REPEAT = 0x8, X_SAME = 0x10, Y_SAME = 0x20 };
+	const unsigned char *end = g + len;
+	int contours = (int16_t)read_u16( g );
+	const unsigned char *p = g + 10 + 2 * contours;
+	if (contours <= 0 || p + 2 > end) return false;
+	size_t n = read_u16( p - 2 ) + 1;
+	p += 2 + read_u16( p ); // instructions
+	std::vector<unsigned char> flags( n );
+	for ( size_t i = 0 ; i < n ; ) {
+		if (p >= end) return false;
+		unsigned char f = *p++;
+		size_t repeat = 1;
+		if (f & REPEAT) { if (p >= end) return false; repeat += *p++; }
+		while (repeat-- && i < n) flags[i++] = f;
+	}
+	// x deltas, then y deltas
+	int coord[2] = { 0, 0 }, lo[2], hi[2];
+	for ( int axis = 0 ; axis < 2 ; axis++ ) {
+		unsigned char is_short = axis ? Y_SHORT : X_SHORT, same = axis ? Y_SAME : X_SAME;
+		for ( size_t i = 0 ; i < n ; i++ ) {
+			if (flags[i] & is_short) {
+				if (p + 1 > end) return false;
+				coord[axis] += (flags[i] & same) ? *p : -*p;
+				p += 1;
+			} else if (!(flags[i] & same)) {
+				if (p + 2 > end) return false;
+				coord[axis] += (int16_t)read_u16( p );
+				p += 2;
+			}
+			if (i == 0 || coord[axis] < lo[axis]) lo[axis] = coord[axis];
+			if (i == 0 || coord[axis] > hi[axis]) hi[axis] = coord[axis];
+		}
+	}
+	xmin = lo[0]; ymin = lo[1]; xmax = hi[0]; ymax = hi[1];
+	return true;
+}
+
+// the slow way, through FT_Load_Glyph
+inline metrics_entry loaded_metrics( FT_Face face, FT_UInt gid )
+{
+	metrics_entry e = metrics_entry();
+	if (FT_Load_Glyph( face, gid, FT_LOAD_NO_SCALE | FT_LOAD_NO_HINTING )) return e;
+	FT_Glyph_Metrics &gm = face->glyph->metrics;
+	e.advance = gm.horiAdvance;
+	e.bearing_x = gm.horiBearingX;
+	e.bearing_y = gm.horiBearingY;
+	e.vert_advance = gm.vertAdvance;
+	e.vert_bearing_y = gm.vertBearingY;
+	e.width = gm.width;
+	e.height = gm.height;
+	return e;
+}
+
+} // namespace metrics_detail
+
+inline metrics_table read_metrics( ttf_file &file )
+{
+	using namespace metrics_detail;
+	FT_Face face = file.face;
+	metrics_table m;
+	m.units_per_em = face->units_per_EM;
+	m.glyphs.resize( face->num_glyphs );
+
+	std::vector<unsigned char> glyf = load_table( face, TTAG_glyf );
+	std::vector<unsigned char> loca = load_table( face, TTAG_loca );
+	std::vector<unsigned char> head = load_table( face, TTAG_head );
+	std::vector<unsigned char> hhea = load_table( face, TTAG_hhea );
+	std::vector<unsigned char> hmtx = load_table( face, TTAG_hmtx );
+	std::vector<unsigned char> vhea = load_table( face, TTAG_vhea );
+	std::vector<unsigned char> vmtx = load_table( face, TTAG_vmtx );
+	bool long_loca = head.size() >= 54 && read_u16( &head[50] ) == 1;
+	m.from_tables = glyf.size() && head.size() >= 54 && hhea.size() >= 36 && hmtx.size()
+		&& loca.size() >= (m.glyphs.size() + 1) * (long_loca ? 4 : 2)
+		&& !FT_HAS_MULTIPLE_MASTERS( face );
+
+	if (m.from_tables) {
+		unsigned hmetrics = read_u16( &hhea[34] );
+		unsigned vmetrics = vhea.size() >= 36 && vmtx.size() ? read_u16( &vhea[34] ) : 0;
+		// no 'vmtx': the same numbers FreeType makes up (glyph centered
+		// in the line height)
+		TT_OS2 *os2 = (TT_OS2 *)FT_Get_Sfnt_Table( face, FT_SFNT_OS2 );
+		bool typo = os2 && os2->version != 0xFFFFU;
+		int ascender = typo ? os2->sTypoAscender : (int16_t)read_u16( &hhea[4] );
+		int descender = typo ? os2->sTypoDescender : (int16_t)read_u16( &hhea[6] );
+
+		for ( FT_UInt gid = 0 ; gid < m.glyphs.size() ; gid++ ) {
+			metrics_entry &e = m.glyphs[gid];
+			int lsb, tsb;
+			long_metric( hmtx, hmetrics, gid, e.advance, lsb );
+
+			size_t start = long_loca ? read_u32( &loca[gid*4] ) : 2 * read_u16( &loca[gid*2] );
+			size_t end = long_loca ? read_u32( &loca[gid*4+4] ) : 2 * read_u16( &loca[gid*2+2] );
+			int xmin = 0, ymin = 0, xmax = 0, ymax = 0;
+			if (end > start + 10 && end <= glyf.size()) {
+				const unsigned char *g = &glyf[start];
+				if ((int16_t)read_u16( g ) < 0) {
+					// composite: the box in the header can be a unit off from
+					// the box of the transformed components; ask FreeType
+					e = loaded_metrics( face, gid );
+					continue;
+				}
+				// FreeType measures the points, not the box in the header (which
+				// is sometimes stale), and moves the glyph so the header's xMin
+				// sits at the left side bearing from 'hmtx'
+				int header_xmin = (int16_t)read_u16( g + 2 );
+				if (!point_box( g, end - start, xmin, ymin, xmax, ymax )) {
+					e = loaded_metrics( face, gid );
+					continue;
+				}
+				xmin += lsb - header_xmin;
+				xmax += lsb - header_xmin;
+			}
+			e.bearing_x = xmin;
+			e.bearing_y = ymax;
+			e.width = xmax - xmin;
+			e.height = ymax - ymin;
+
+			if (vmetrics) {
+				long_metric( vmtx, vmetrics, gid, e.vert_advance, tsb );
+				e.vert_bearing_y = tsb;
+			} else {
+				e.vert_advance = std::abs( ascender - descender );
+				e.vert_bearing_y = (e.vert_advance - e.height) / 2;
+			}
+		}
+	} else {
+		for ( FT_UInt gid = 0 ; gid < m.glyphs.size() ; gid++ )
+			m.glyphs[gid] = loaded_metrics( face, gid );
+	}
+	read_kern( face, m.kerning );
+	return m;
+}
+
+inline std::string metrics_json( const metrics_table &m )
+{
+	text_stream tmp;
+	tmp << "{\"units_per_em\": " << m.units_per_em
+		<< ",\n \"fields\": [\"advance\", \"bearing_x\", \"bearing_y\", \"vert_advance\","
+		<< " \"vert_bearing_y\", \"width\", \"height\"],\n \"glyphs\": [";
+	for ( size_t i = 0 ; i < m.glyphs.size() ; i++ ) {
+		const metrics_entry &e = m.glyphs[i];
+		tmp << (i ? ",\n  [" : "\n  [") << e.advance << "," << e.bearing_x << "," << e.bearing_y
+			<< "," << e.vert_advance << "," << e.vert_bearing_y << "," << e.width << "," << e.height << "]";
+	}
+	tmp << "],\n \"kerning\": [";
+	for ( size_t i = 0 ; i < m.kerning.size() ; i++ )
+		tmp << (i ? ",\n  [" : "\n  [") << m.kerning[i].left << "," << m.kerning[i].right
+			<< "," << m.kerning[i].value << "]";
+	tmp << "]}\n";
+	return tmp.str();
+}
+
+/* Binary form, all numbers little endian:
+   "F2SM", version (1), units per em, glyph count, kern pair count  (5 x 4 bytes)
+   per glyph: the 7 fields of metrics_entry                          (7 x int32)
+   per kern pair: left, right (uint16), value (int16), 0 (int16)    (8 bytes) */
+inline std::string metrics_binary( const metrics_table &m )
+{
+	std::string out;
+	out.reserve( 20 + m.glyphs.size() * 28 + m.kerning.size() * 8 );
+	struct le {
+		static void put( std::string &s, uint32_t v, int bytes )
+		{
+			for ( int i = 0 ; i < bytes ; i++ ) s += (char)((v >> (8*i)) & 0xFF);
+		}
+	};
+	out += "F2SM";
+	le::put( out, 1, 4 );
+	le::put( out, m.units_per_em, 4 );
+	le::put( out, m.glyphs.size(), 4 );
+	le::put( out, m.kerning.size(), 4 );
+	for ( size_t i = 0 ; i < m.glyphs.size() ; i++ ) {
+		const metrics_entry &e = m.glyphs[i];
+		int32_t f[7] = { e.advance, e.bearing_x, e.bearing_y, e.vert_advance, e.vert_bearing_y, e.width, e.height };
+		for ( int j = 0 ; j < 7 ; j++ ) le::put( out, (uint32_t)f[j], 4 );
+	}
+	for ( size_t i = 0 ; i < m.kerning.size() ; i++ ) {
+		le::put( out, m.kerning[i].left, 2 );
+		le::put( out, m.kerning[i].right, 2 );
+		le::put( out, (uint16_t)m.kerning[i].value, 2 );
+		le::put( out, 0, 2 );
+	}
+	return out;
+}
+
+} // namespace
+
+#endif
@@ -0,0 +1,256 @@
+// font_to_svg_names.hpp - glyph names and codepoints, looked up both ways
+// Copyright Don Bright 2013 <hugh.m.bright@gmail.com>
+/*
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+
+  License based on zlib license, by Jean-loup Gailly and Mark Adler
+*/
+
+/*
+
+glyph_names reads a face's character map and glyph names once, and then
+answers, without calling FreeType:
+
+ name( gid )        the glyph's PostScript name ("A", "uni2766", ...)
+ gid( name )        the glyph with that name, or -1
+ codepoints( gid )  every character that maps to the glyph, in order
+ glyph( codepoint ) the glyph a character maps to, or 0
+
+Names come straight from the 'post' table (formats 1, 2 and 2.5). Fonts
+whose names are elsewhere (CFF) get them from FreeType, once per glyph,
+while the index is built. It is all kept in a few flat arrays:
+
+ names       every name, each followed by a 0, back to back
+ name_at     where each glyph's name starts in 'names'
+ slots       hash table, name -> gid + 1 (0 = empty), open addressing
+ cp_at       where each glyph's codepoints start in 'cps' (CSR)
+ cps         codepoints, grouped by glyph
+ by_cp       (codepoint, gid), sorted by codepoint
+
+Once built it is read only, so one index can serve any number of threads.
+
+ post: https://learn.microsoft.com/typography/opentype/spec/post
+
+*/
+
+#ifndef __font_to_svg_names_h__
+#define __font_to_svg_names_h__
+
+#include "font_to_svg.hpp"
+#include <cstring>
+
+namespace font2svg {
+
+// The 258 glyph names of the Macintosh character set, used by 'post'
+inline const char *mac_glyph_names[258] = {
+	".notdef", ".null", "nonmarkingreturn", "space", "exclam", "quotedbl",
+	"numbersign", "dollar", "percent", "ampersand", "quotesingle",
+	"parenleft", "parenright", "asterisk", "plus", "comma", "hyphen",
+	"period", "slash", "zero", "one", "two", "three", "four", "five", "six",
+	"seven", "eight", "nine", "colon", "semicolon", "less", "equal",
+	"greater", "question", "at", "A", "B", "C", "D", "E", "F", "G", "H", "I",
+	"J", "K", "L", "M", "N", "O", "P", "Q", "R", "S", "T", "U", "V", "W", "X",
+	"Y", "Z", "bracketleft", "backslash", "bracketright", "asciicircum",
+	"underscore", "grave", "a", "b", "c", "d", "e", "f", "g", "h", "i", "j",
+	"k", "l", "m", "n", "o", "p", "q", "r", "s", "t", "u", "v", "w", "x", "y",
+	"z", "braceleft", "bar", "braceright", "asciitilde", "Adieresis", "Aring",
+	"Ccedilla", "Eacute", "Ntilde", "Odieresis", "Udieresis", "aacute",
+	"agrave", "acircumflex", "adieresis", "atilde", "aring", "ccedilla",
+	"eacute", "egrave", "ecircumflex", "edieresis", "iacute", "igrave",
+	"icircumflex", "idieresis", "ntilde", "oacute", "ograve", "ocircumflex",
+	"odieresis", "otilde", "uacute", "ugrave", "ucircumflex", "udieresis",
+	"dagger", "degree", "cent", "sterling", "section", "bullet", "paragraph",
+	"germandbls", "registered", "copyright", "trademark", "acute", "dieresis",
+	"notequal", "AE", "Oslash", "infinity", "plusminus", "lessequal",
+	"greaterequal", "yen", "mu", "partialdiff", "summation", "product", "pi",
+	"integral", "ordfeminine", "ordmasculine", "Omega", "ae", "oslash",
+	"questiondown", "exclamdown", "logicalnot", "radical", "florin",
+	"approxequal", "Delta", "guillemotleft", "guillemotright", "ellipsis",
+	"nonbreakingspace", "Agrave", "Atilde", "Otilde", "OE", "oe", "endash",
+	"emdash", "quotedblleft", "quotedblright", "quoteleft", "quoteright",
+	"divide", "lozenge", "ydieresis", "Ydieresis", "fraction", "currency",
+	"guilsinglleft", "guilsinglright", "fi", "fl", "daggerdbl",
+	"periodcentered", "quotesinglbase", "quotedblbase", "perthousand",
+	"Acircumflex", "Ecircumflex", "Aacute", "Edieresis", "Egrave", "Iacute",
+	"Icircumflex", "Idieresis", "Igrave", "Oacute", "Ocircumflex", "apple",
+	"Ograve", "Uacute", "Ucircumflex", "Ugrave", "dotlessi", "circumflex",
+	"tilde", "macron", "breve", "dotaccent", "ring", "cedilla",
+	"hungarumlaut", "ogonek", "caron", "Lslash", "lslash", "Scaron", "scaron",
+	"Zcaron", "zcaron", "brokenbar", "Eth", "eth", "Yacute", "yacute",
+	"Thorn", "thorn", "minus", "multiply", "onesuperior", "twosuperior",
+	"threesuperior", "onehalf", "onequarter", "threequarters", "franc",
+	"Gbreve", "gbreve", "Idotaccent", "Scedilla", "scedilla", "Cacute",
+	"cacute", "Ccaron", "ccaron", "dcroat"
+};
+
+// The codepoints of one glyph: a range of a glyph_names' array
+struct codepoint_list
+{
+	const uint32_t *first, *last;
+	const uint32_t *begin() const { return first; }
+	const uint32_t *end() const { return last; }
+	size_t size() const { return last - first; }
+	bool empty() const { return first == last; }
+};
+
+class glyph_names
+{
+public:
+	glyph_names( ttf_file &f )
+	{
+		FT_Face face = f.face;
+		num_glyphs = face->num_glyphs > 0 ? face->num_glyphs : 0;
+		read_names( face );
+		read_cmap( face );
+	}
+
+	size_t size() const { return num_glyphs; }
+
+	// "" for glyphs without a name (and ids past the end)
+	const char *name( FT_UInt gid ) const
+	{
+		return gid < num_glyphs ? &names[ name_at[gid] ] : "";
+	}
+
+	// The glyph named 'n' (the first, if several share it), or -1
+	long gid( const char *n ) const
+	{
+		if (slots.empty() || !*n) return -1;
+		size_t mask = slots.size() - 1;
+		for ( size_t i = hash( n ) & mask ; slots[i] ; i = (i + 1) & mask ) {
+			FT_UInt g = slots[i] - 1;
+			if (!strcmp( name( g ), n )) return g;
+		}
+		return -1;
+	}
+	long gid( const std::string &n ) const { return gid( n.c_str() ); }
+
+	// Every codepoint mapping to the glyph, lowest first
+	codepoint_list codepoints( FT_UInt gid ) const
+	{
+		codepoint_list l = { NULL, NULL };
+		if (gid < num_glyphs && cp_at[gid] < cp_at[gid+1]) {
+			l.first = &cps[ cp_at[gid] ];
+			l.last = l.first + (cp_at[gid+1] - cp_at[gid]);
+		}
+		return l;
+	}
+
+	// The glyph for a codepoint, as FT_Get_Char_Index gives it; 0 if none
+	FT_UInt glyph( uint32_t codepoint ) const
+	{
+		std::vector< std::pair<uint32_t,uint32_t> >::const_iterator it = std::lower_bound(
+			by_cp.begin(), by_cp.end(), std::make_pair( codepoint, (uint32_t)0 ) );
+		return it != by_cp.end() && it->first == codepoint ? it->second : 0;
+	}
+
+private:
+	size_t num_glyphs;
+	std::vector<char> names;
+	std::vector<uint32_t> name_at, slots, cp_at, cps;
+	std::vector< std::pair<uint32_t,uint32_t> > by_cp;
+
+	static uint32_t hash( const char *s )
+	{
+		uint32_t h = 2166136261u;
+		for ( ; *s ; s++ ) h = (h ^ (unsigned char)*s) * 16777619u;
+		return h;
+	}
+
+	void add_name( const char *s, size_t len )
+	{
+		name_at.push_back( names.size() );
+		names.insert( names.end(), s, s + len );
+		names.push_back( 0 );
+	}
+
+	/* post 1: the Mac names, in order. post 2: per glyph, a number below
+	258 for a Mac name, or 258 + n for the n-th of the Pascal strings
+	after the numbers. post 2.5: per glyph, an offset into the Mac names. */
+	void read_names( FT_Face face )
+	{
+		std::vector<unsigned char> post = load_table( face, TTAG_post );
+		uint32_t version = post.size() >= 32 ? read_u32( &post[0] ) : 0;
+		names.reserve( num_glyphs * 8 );
+		name_at.reserve( num_glyphs + 1 );
+		if (version == 0x00020000 && post.size() >= 34 + 2 * (size_t)read_u16( &post[32] )) {
+			size_t n = read_u16( &post[32] ), at = 34 + 2 * n;
+			std::vector< std::pair<const char *, size_t> > extra;
+			while (at < post.size()) {
+				size_t len = post[at];
+				if (at + 1 + len > post.size()) break;
+				extra.push_back( std::make_pair( (const char *)&post[at+1], len ) );
+				at += 1 + len;
+			}
+			for ( size_t g = 0 ; g < num_glyphs ; g++ ) {
+				unsigned i = g < n ? read_u16( &post[34 + 2*g] ) : 0;
+				if (i < 258) add_name( mac_glyph_names[i], strlen( mac_glyph_names[i] ) );
+				else if (i - 258 < extra.size()) add_name( extra[i-258].first, extra[i-258].second );
+				else add_name( "", 0 );
+			}
+		} else if (version == 0x00010000 || (version == 0x00025000 && post.size() >= 34)) {
+			size_t n = version == 0x00025000 ? read_u16( &post[32] ) : 0;
+			for ( size_t g = 0 ; g < num_glyphs ; g++ ) {
+				long i = g;
+				if (version == 0x00025000) i = g < n && 34 + g < post.size() ? g + (signed char)post[34 + g] : -1;
+				if (i >= 0 && i < 258) add_name( mac_glyph_names[i], strlen( mac_glyph_names[i] ) );
+				else add_name( "", 0 );
+			}
+		} else {
+			char buf[256];
+			bool have = FT_HAS_GLYPH_NAMES( face );
+			for ( size_t g = 0 ; g < num_glyphs ; g++ ) {
+				buf[0] = 0;
+				if (have) FT_Get_Glyph_Name( face, g, buf, sizeof buf );
+				add_name( buf, strlen( buf ) );
+			}
+		}
+		name_at.push_back( names.size() );
+
+		// at most half full, so probe runs stay short
+		size_t cap = 16;
+		while (cap < 2 * num_glyphs) cap *= 2;
+		slots.assign( cap, 0 );
+		for ( size_t g = 0 ; g < num_glyphs ; g++ ) {
+			const char *n = name( g );
+			if (!*n || gid( n ) >= 0) continue;
+			size_t i = hash( n ) & (cap - 1);
+			while (slots[i]) i = (i + 1) & (cap - 1);
+			slots[i] = g + 1;
+		}
+	}
+
+	// One pass over the character map, then a counting sort by glyph
+	void read_cmap( FT_Face face )
+	{
+		FT_UInt g;
+		for ( FT_ULong c = FT_Get_First_Char( face, &g ) ; g ; c = FT_Get_Next_Char( face, c, &g ) )
+			if (g < num_glyphs) by_cp.push_back( std::make_pair( (uint32_t)c, (uint32_t)g ) );
+		std::sort( by_cp.begin(), by_cp.end() );
+		cp_at.assign( num_glyphs + 1, 0 );
+		for ( size_t i = 0 ; i < by_cp.size() ; i++ ) cp_at[ by_cp[i].second + 1 ]++;
+		for ( size_t g = 0 ; g < num_glyphs ; g++ ) cp_at[g+1] += cp_at[g];
+		cps.resize( by_cp.size() );
+		std::vector<uint32_t> next( cp_at.begin(), cp_at.end() - 1 );
+		for ( size_t i = 0 ; i < by_cp.size() ; i++ ) cps[ next[ by_cp[i].second ]++ ] = by_cp[i].first;
+	}
+};
+
+} // namespace
+
+#endif
@@ -0,0 +1,321 @@
+// font_to_svg_pipeline.hpp - asynchronous conversion, in overlapping stages
+// Copyright Don Bright 2013 <hugh.m.bright@gmail.com>
+/*
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+
+  License based on zlib license, by Jean-loup Gailly and Mark Adler
+*/
+
+/*
+
+Converting a batch (some characters of one font) has three quite
+different parts:
+
+ read    the font file into memory (waiting on the disk)
+ load    open the face, load the glyphs and rebuild their outlines
+         (FreeType, CPU); the face and file are let go once the glyphs
+         have their own copies
+ write   the svg documents (CPU, allocation)
+
+A pipeline runs each part on a thread of its own, with a short queue
+between each and the next, so while one batch is being written the next
+one's glyphs are loading and the font after that is being read.
+
+submit() hands in a batch and returns a std::future for the documents,
+or calls a callback (on the writing thread) when they are done; either
+way the caller does not wait for files or outlines. Batches finish in
+the order they were submitted.
+
+The memory held is bounded. At most 'max_batches' batches are in the
+pipeline at once: submit() waits for room, try_submit() returns false
+instead. And font files held in memory add up to at most 'max_bytes'
+(one file is always let in, however big): the reading stage waits until
+the loading stage has let go of enough. A full queue makes the stage
+before it wait, so a slow stage holds up the ones before it instead of
+work piling up in between.
+
+Set font2svg::quiet before submitting. Without it, the loading and
+writing threads both print debug output, and the loading thread adds to
+the shared 'debug' stream for every font, so it grows as long as the
+pipeline runs.
+
+*/
+
+#ifndef __font_to_svg_pipeline_h__
+#define __font_to_svg_pipeline_h__
+
+#include "font_to_svg.hpp"
+#include "font_to_svg_arena.hpp"
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+
+namespace font2svg {
+
+// A queue of at most 'capacity' items, for one stage to hand work to the next.
+template <class T>
+class bounded_queue
+{
+public:
+	bounded_queue( size_t capacity ) : cap( capacity ? capacity : 1 ), closed( false ) {}
+
+	// Waits while the queue is full. False if it was closed.
+	bool push( T item )
+	{
+		std::unique_lock<std::mutex> held( lock );
+		not_full.wait( held, [&]() { return closed || items.size() < cap; } );
+		if (closed) return false;
+		items.push_back( std::move( item ) );
+		not_empty.notify_one();
+		return true;
+	}
+
+	// Waits while the queue is empty. False once it is closed and empty.
+	bool pop( T &item )
+	{
+		std::unique_lock<std::mutex> held( lock );
+		not_empty.wait( held, [&]() { return closed || !items.empty(); } );
+		if (items.empty()) return false;
+		item = std::move( items.front() );
+		items.pop_front();
+		not_full.notify_one();
+		return true;
+	}
+
+	// No more pushes; what is queued can still be popped.
+	void close()
+	{
+		std::lock_guard<std::mutex> held( lock );
+		closed = true;
+		not_full.notify_all();
+		not_empty.notify_all();
+	}
+
+private:
+	size_t cap;
+	bool closed;
+	std::deque<T> items;
+	std::mutex lock;
+	std::condition_variable not_full, not_empty;
+};
+
+struct batch_result
+{
+	std::string font;
+	std::vector<int> codepoints;
+	std::vector<std::string> svgs; // one per codepoint, empty if not in the font
+	                               // (or if the font could not be used)
+	std::string error;             // why the font could not be used, if it could not
+};
+
+class pipeline
+{
+public:
+	/* 'max_batches' and 'max_bytes' bound the work in flight (see above).
+	'queue' is the length of each queue between stages. */
+	pipeline( size_t max_batches = 8, size_t max_bytes = 256 << 20, size_t queue = 2 )
+		: limit_batches( max_batches ? max_batches : 1 ), limit_bytes( max_bytes ),
+		  batches( 0 ), bytes( 0 ), to_read( queue ), to_load( queue ), to_write( queue )
+	{
+		stages.push_back( std::thread( [this]() { reader(); } ) );
+		stages.push_back( std::thread( [this]() { loader(); } ) );
+		stages.push_back( std::thread( [this]() { writer(); } ) );
+	}
+
+	// Finishes the batches already submitted, then stops.
+	~pipeline()
+	{
+		to_read.close();
+		for ( size_t i = 0 ; i < stages.size() ; i++ ) stages[i].join();
+	}
+
+	typedef std::function<void( batch_result & )> callback;
+
+	/* Convert 'codepoints' of a font file (face 'face_index' of a
+	collection). 'done' runs on the writing thread and must not throw, or
+	call submit() (which could wait for itself; try_submit() is fine).
+	Waits while max_batches batches are in flight. */
+	void submit( std::string font, std::vector<int> codepoints, callback done, int face_index = 0 )
+	{
+		{
+			std::unique_lock<std::mutex> held( budget_lock );
+			room.wait( held, [&]() { return batches < limit_batches; } );
+			batches++;
+		}
+		enqueue( font, codepoints, done, face_index );
+	}
+
+	std::future<batch_result> submit( std::string font, std::vector<int> codepoints, int face_index = 0 )
+	{
+		std::shared_ptr< std::promise<batch_result> > p( new std::promise<batch_result> );
+		std::future<batch_result> f = p->get_future();
+		submit( font, codepoints, [p]( batch_result &r ) { p->set_value( std::move( r ) ); }, face_index );
+		return f;
+	}
+
+	// As submit(), but false at once if the pipeline is full.
+	bool try_submit( std::string font, std::vector<int> codepoints, callback done, int face_index = 0 )
+	{
+		{
+			std::lock_guard<std::mutex> held( budget_lock );
+			if (batches >= limit_batches) return false;
+			batches++;
+		}
+		enqueue( font, codepoints, done, face_index );
+		return true;
+	}
+
+	// batches submitted and not yet done
+	size_t in_flight()
+	{
+		std::lock_guard<std::mutex> held( budget_lock );
+		return batches;
+	}
+
+private:
+	struct job
+	{
+		batch_result result;
+		int face_index;
+		callback done;
+		std::vector<unsigned char> data; // the font file, until loaded
+		std::vector< std::unique_ptr<glyph> > glyphs;
+	};
+	typedef std::unique_ptr<job> job_ptr;
+
+	size_t limit_batches, limit_bytes, batches, bytes;
+	std::mutex budget_lock;
+	std::condition_variable room;
+	bounded_queue<job_ptr> to_read, to_load, to_write;
+	std::vector<std::thread> stages;
+
+	void enqueue( std::string &font, std::vector<int> &codepoints, callback &done, int face_index )
+	{
+		job_ptr j( new job );
+		j->result.font = font;
+		j->result.codepoints = codepoints;
+		j->done = done;
+		j->face_index = face_index;
+		to_read.push( std::move( j ) );
+	}
+
+	void release_bytes( size_t n )
+	{
+		std::lock_guard<std::mutex> held( budget_lock );
+		bytes -= n;
+		room.notify_all();
+	}
+
+	void reader()
+	{
+		job_ptr j;
+		while (to_read.pop( j )) {
+			std::ifstream in( j->result.font.c_str(), std::ios::binary );
+			in.seekg( 0, std::ios::end );
+			std::streamoff end = in ? (std::streamoff)in.tellg() : -1;
+			size_t size = end > 0 ? (size_t)end : 0;
+			if (size == 0) {
+				j->result.error = "can not read " + j->result.font;
+			} else {
+				{
+					std::unique_lock<std::mutex> held( budget_lock );
+					room.wait( held, [&]() { return bytes == 0 || bytes + size <= limit_bytes; } );
+					bytes += size;
+				}
+				j->data.resize( size );
+				in.seekg( 0 );
+				if (!in.read( (char *)&j->data[0], size )) {
+					j->result.error = "can not read " + j->result.font;
+					j->data.clear();
+					release_bytes( size );
+				}
+			}
+			to_load.push( std::move( j ) );
+		}
+		to_load.close();
+	}
+
+	void loader()
+	{
+		job_ptr j;
+		while (to_load.pop( j )) {
+			size_t size = j->data.size();
+			if (size) {
+				// not ttf_file( data, ... ), which exits on a bad font
+				ttf_file file;
+				file.filename = j->result.font;
+				file.library = NULL;
+				file.error = FT_Init_FreeType( &file.library );
+				{
+					FONT2SVG_TIME( face_open );
+					if (!file.error) file.error = FT_New_Memory_Face( file.library,
+						&j->data[0], size, j->face_index, &file.face );
+				}
+				if (file.error) {
+					j->result.error = "can not open font " + j->result.font;
+					if (file.library) FT_Done_FreeType( file.library );
+				} else {
+					std::vector<int> &cps = j->result.codepoints;
+					for ( size_t i = 0 ; i < cps.size() ; i++ ) {
+						FT_UInt gid = FT_Get_Char_Index( file.face, cps[i] );
+						j->glyphs.push_back( std::unique_ptr<glyph>(
+							gid ? new glyph( file, cps[i], gid, "" ) : NULL ) );
+					}
+					// the glyphs have their own copies of what the writer needs
+					file.free();
+				}
+				std::vector<unsigned char>().swap( j->data );
+				release_bytes( size );
+			}
+			to_write.push( std::move( j ) );
+		}
+		to_write.close();
+	}
+
+	void writer()
+	{
+		arena scratch;
+		job_ptr j;
+		while (to_write.pop( j )) {
+			for ( size_t i = 0 ; i < j->result.codepoints.size() ; i++ ) {
+				std::string svg;
+				if (i < j->glyphs.size() && j->glyphs[i]) {
+					scratch.release();
+					std::pmr::string doc = document( *j->glyphs[i], &scratch );
+					svg.assign( doc.data(), doc.size() );
+					FONT2SVG_COUNT( bytes, svg.size() );
+				}
+				j->result.svgs.push_back( svg );
+			}
+			j->glyphs.clear();
+			if (j->done) j->done( j->result );
+			j.reset();
+			std::lock_guard<std::mutex> held( budget_lock );
+			batches--;
+			room.notify_all();
+		}
+	}
+};
+
+} // namespace
+
+#endif
@@ -0,0 +1,516 @@
+// font_to_svg_sdf.hpp - signed distance fields from TrueType (R) outlines
+// Copyright Don Bright 2013 <hugh.m.bright@gmail.com>
+/*
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+
+  License based on zlib license, by Jean-loup Gailly and Mark Adler
+*/
+
+/*
+
+Distance fields are computed straight from the quadratic segments that
+outline_segments() reconstructs, so they match the SVG path exactly. The
+pixel grid is walked one row at a time: the sign (inside/outside) comes
+from the non-zero winding of a horizontal scanline through the row, and
+the distance from each nearby segment is swept across the row.
+
+Only segments whose y band (widened by 'range') holds the row are looked
+at, and each only over the columns within 'range' of its x band: further
+away the distance clamps anyway. Straight segments are swept two columns
+at a time with SSE2 (-DFONT2SVG_NO_SIMD turns it off); curved ones are
+done a pixel at a time, as finding the closest point means solving a
+cubic, with branches that do not suit SIMD.
+
+Two kinds of field are produced:
+
+ sdf  - one channel, true signed distance
+ msdf - three channels, edges split into colors at corners, so that the
+        median of r,g,b keeps sharp corners when magnified
+
+Values are stored as bytes, 128 = on the outline, larger = inside.
+'range' is the distance in pixels that maps onto the full 0..255 span.
+
+See also:
+ Green, "Improved Alpha-Tested Magnification for Vector Textures", 2007
+ Chlumsky, "Shape Decomposition for Multi-channel Distance Fields", 2015
+
+*/
+
+#ifndef __font_to_svg_sdf_h__
+#define __font_to_svg_sdf_h__
+
+#include "font_to_svg.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <thread>
+#include <atomic>
+
+namespace font2svg {
+
+struct distance_field
+{
+	int codepoint;
+	int width, height, channels;
+	std::vector<unsigned char> data;
+	distance_field() : codepoint(0), width(0), height(0), channels(1) {}
+};
+
+// Where a glyph sits in a packed atlas.
+struct atlas_cell
+{
+	int codepoint;
+	int x, y;
+};
+
+struct distance_atlas
+{
+	int width, height, channels, cellsize;
+	std::vector<atlas_cell> cells;
+	std::vector<unsigned char> data;
+};
+
+struct sdf_options
+{
+	int size;        // pixels per side of each glyph field
+	double range;    // distance, in pixels, covered by 0..255
+	bool msdf;
+	int threads;     // 0 = one per hardware thread
+	sdf_options() : size(32), range(4), msdf(false), threads(0) {}
+};
+
+namespace sdf_detail {
+
+enum { RED = 1, GREEN = 2, BLUE = 4, WHITE = 7 };
+
+// segment from outline_segments(), moved to pixel space
+struct fseg
+{
+	bool quad;
+	int color;
+	double x0, y0, cx, cy, x1, y1;
+	double xmin, xmax, ymin, ymax;
+};
+
+inline double cross( double ax, double ay, double bx, double by ) { return ax*by - ay*bx; }
+
+// real roots of a*t^3 + b*t^2 + c*t + d, returns count
+inline int solve_cubic( double a, double b, double c, double d, double *t )
+{
+	if (fabs(a) < 1e-12) {
+		if (fabs(b) < 1e-12) {
+			if (fabs(c) < 1e-12) return 0;
+			t[0] = -d/c;
+			return 1;
+		}
+		double disc = c*c - 4*b*d;
+		if (disc < 0) return 0;
+		disc = sqrt(disc);
+		t[0] = (-c + disc) / (2*b);
+		t[1] = (-c - disc) / (2*b);
+		return 2;
+	}
+	b /= a; c /= a; d /= a;
+	double q = (b*b - 3*c) / 9;
+	double r = (b*(2*b*b - 9*c) + 27*d) / 54;
+	double q3 = q*q*q;
+	if (r*r < q3) {
+		const double pi = 3.14159265358979323846; // M_PI is not standard
+		double th = acos( std::max(-1.0, std::min(1.0, r/sqrt(q3))) );
+		double m = -2*sqrt(q);
+		t[0] = m*cos(th/3) - b/3;
+		t[1] = m*cos((th+2*pi)/3) - b/3;
+		t[2] = m*cos((th-2*pi)/3) - b/3;
+		return 3;
+	}
+	double A = -cbrt( fabs(r) + sqrt(r*r - q3) );
+	if (r < 0) A = -A;
+	double B = (A == 0) ? 0 : q/A;
+	t[0] = (A + B) - b/3;
+	return 1;
+}
+
+/* Closest point on the segment to (px,py). Returns squared distance, and
+the cross product of the tangent there with the vector to the pixel, whose
+sign tells which side of the edge the pixel is on. */
+inline double closest( const fseg &s, double px, double py, double &side )
+{
+	if (!s.quad) {
+		double dx = s.x1 - s.x0, dy = s.y1 - s.y0;
+		double len2 = dx*dx + dy*dy;
+		double t = len2 > 0 ? ((px-s.x0)*dx + (py-s.y0)*dy) / len2 : 0;
+		t = std::max( 0.0, std::min( 1.0, t ) );
+		double qx = s.x0 + t*dx - px, qy = s.y0 + t*dy - py;
+		side = cross( dx, dy, -qx, -qy );
+		return qx*qx + qy*qy;
+	}
+	// B(t) = p0 + 2t a + t^2 b
+	double ax = s.cx - s.x0, ay = s.cy - s.y0;
+	double bx = s.x1 - 2*s.cx + s.x0, by = s.y1 - 2*s.cy + s.y0;
+	double mx = s.x0 - px, my = s.y0 - py;
+	double ts[5];
+	int n = solve_cubic( bx*bx + by*by, 3*(ax*bx + ay*by),
+		2*(ax*ax + ay*ay) + mx*bx + my*by, mx*ax + my*ay, ts );
+	ts[n++] = 0;
+	ts[n++] = 1;
+	double best = 1e300;
+	for ( int k = 0 ; k < n ; k++ ) {
+		double t = ts[k];
+		if (t < 0 || t > 1) continue;
+		double qx = mx + 2*t*ax + t*t*bx, qy = my + 2*t*ay + t*t*by;
+		double d2 = qx*qx + qy*qy;
+		if (d2 < best) {
+			best = d2;
+			side = cross( ax + t*bx, ay + t*by, -qx, -qy );
+		}
+	}
+	return best;
+}
+
+/* closest() for the pixels of columns c0..c1 of the row at height py:
+squared distances into d2[c0..c1], sides into side[c0..c1]. */
+inline void sweep( const fseg &s, double py, int c0, int c1, double *d2, double *side )
+{
+	int col = c0;
+	double dx = s.x1 - s.x0, dy = s.y1 - s.y0;
+	double len2 = dx*dx + dy*dy;
+#ifdef FONT2SVG_SSE2
+	// the same arithmetic as closest(), in the same order, so the results
+	// are identical to the last bit
+	if (!s.quad && len2 > 0) {
+		const __m128d zero = _mm_setzero_pd(), one = _mm_set1_pd( 1.0 );
+		const __m128d neg = _mm_set1_pd( -0.0 );
+		const __m128d x0 = _mm_set1_pd( s.x0 ), y0 = _mm_set1_pd( s.y0 );
+		const __m128d vdx = _mm_set1_pd( dx ), vdy = _mm_set1_pd( dy );
+		const __m128d vlen2 = _mm_set1_pd( len2 ), vpy = _mm_set1_pd( py );
+		const __m128d ty = _mm_set1_pd( (py-s.y0)*dy );
+		for ( ; col < c1 ; col += 2 ) {
+			__m128d px = _mm_set_pd( col + 1.5, col + 0.5 );
+			__m128d t = _mm_div_pd( _mm_add_pd( _mm_mul_pd( _mm_sub_pd( px, x0 ), vdx ), ty ), vlen2 );
+			t = _mm_max_pd( zero, _mm_min_pd( one, t ) );
+			__m128d qx = _mm_sub_pd( _mm_add_pd( x0, _mm_mul_pd( t, vdx ) ), px );
+			__m128d qy = _mm_sub_pd( _mm_add_pd( y0, _mm_mul_pd( t, vdy ) ), vpy );
+			__m128d side2 = _mm_sub_pd( _mm_mul_pd( vdx, _mm_xor_pd( qy, neg ) ),
+				_mm_mul_pd( vdy, _mm_xor_pd( qx, neg ) ) );
+			_mm_storeu_pd( side + col, side2 );
+			_mm_storeu_pd( d2 + col, _mm_add_pd( _mm_mul_pd( qx, qx ), _mm_mul_pd( qy, qy ) ) );
+		}
+	}
+#endif
+	for ( ; col <= c1 ; col++ ) d2[col] = closest( s, col + 0.5, py, side[col] );
+}
+
+// add x-positions and directions where the segment crosses scanline y
+inline void crossings( const fseg &s, double y, std::vector<std::pair<double,int> > &out )
+{
+	if (y < s.ymin || y >= s.ymax) return;
+	if (!s.quad) {
+		if (s.y0 == s.y1) return;
+		if ((y < s.y0) == (y < s.y1)) return;
+		double t = (y - s.y0) / (s.y1 - s.y0);
+		out.push_back( std::make_pair( s.x0 + t*(s.x1 - s.x0), s.y1 > s.y0 ? 1 : -1 ) );
+		return;
+	}
+	// y(t) = y0 + 2t(cy-y0) + t^2(y1-2cy+y0)
+	double a = s.y1 - 2*s.cy + s.y0, b = 2*(s.cy - s.y0), c = s.y0 - y;
+	double ts[2];
+	int n = 0;
+	if (fabs(a) < 1e-12) {
+		if (b != 0) ts[n++] = -c/b;
+	} else {
+		double disc = b*b - 4*a*c;
+		if (disc < 0) return;
+		disc = sqrt(disc);
+		ts[n++] = (-b + disc) / (2*a);
+		ts[n++] = (-b - disc) / (2*a);
+	}
+	for ( int k = 0 ; k < n ; k++ ) {
+		double t = ts[k];
+		// half-open in t so that joins between segments count once
+		if (t < 0 || t >= 1) continue;
+		double dy = b + 2*a*t;
+		if (dy == 0) continue;
+		double x = s.x0 + t*(2*(s.cx - s.x0)) + t*t*(s.x1 - 2*s.cx + s.x0);
+		out.push_back( std::make_pair( x, dy > 0 ? 1 : -1 ) );
+	}
+}
+
+inline void tangent( const fseg &s, double t, double &dx, double &dy )
+{
+	if (!s.quad) { dx = s.x1 - s.x0; dy = s.y1 - s.y0; return; }
+	dx = (s.cx - s.x0) + t*(s.x1 - 2*s.cx + s.x0);
+	dy = (s.cy - s.y0) + t*(s.y1 - 2*s.cy + s.y0);
+	if (dx == 0 && dy == 0) { dx = s.x1 - s.x0; dy = s.y1 - s.y0; }
+}
+
+/* Simple edge coloring: contours without corners are white (plain sdf),
+otherwise the color switches at every corner and never repeats across one. */
+inline void color_edges( std::vector<fseg> &segs, const std::vector<int> &contour_of )
+{
+	size_t i = 0;
+	while (i < segs.size()) {
+		size_t end = i;
+		while (end < segs.size() && contour_of[end] == contour_of[i]) end++;
+		size_t n = end - i;
+		std::vector<bool> corner( n, false );
+		int ncorners = 0;
+		for ( size_t k = 0 ; k < n ; k++ ) {
+			const fseg &prev = segs[ i + (k+n-1)%n ];
+			const fseg &cur = segs[ i + k ];
+			double ax, ay, bx, by;
+			tangent( prev, 1, ax, ay );
+			tangent( cur, 0, bx, by );
+			double la = sqrt(ax*ax + ay*ay), lb = sqrt(bx*bx + by*by);
+			if (la == 0 || lb == 0) continue;
+			ax /= la; ay /= la; bx /= lb; by /= lb;
+			if (ax*bx + ay*by <= 0 || fabs(cross(ax,ay,bx,by)) > sin(3.0)) {
+				corner[k] = true;
+				ncorners++;
+			}
+		}
+		if (ncorners < 2) {
+			for ( size_t k = 0 ; k < n ; k++ ) segs[i+k].color = WHITE;
+		} else {
+			const int cycle[3] = { RED|GREEN, GREEN|BLUE, RED|BLUE };
+			size_t first = 0;
+			while (!corner[first]) first++;
+			int c = 0, first_color = cycle[0];
+			for ( size_t k = 0 ; k < n ; k++ ) {
+				size_t idx = (first + k) % n;
+				if (k > 0 && corner[idx]) {
+					c = (c+1) % 3;
+					// the last run must differ from the first one too
+					if (cycle[c] == first_color && idx != first) c = (c+1) % 3;
+				}
+				segs[i+idx].color = cycle[c];
+			}
+		}
+		i = end;
+	}
+}
+
+inline unsigned char encode( double d, double range )
+{
+	double v = 0.5 + d / (2*range);
+	v = std::max( 0.0, std::min( 1.0, v ) );
+	return (unsigned char)(v*255 + 0.5);
+}
+
+} // namespace sdf_detail
+
+/* Build the distance field of one outline. 'scale' turns font units into
+pixels, (xoff,yoff) is the pixel position of the font-unit origin. The
+segments are expected in SVG orientation (y down), as glyph::segments()
+and outline_segments( ..., flip = true ) give them. */
+inline distance_field make_distance_field( const std::vector<segment> &segs,
+	double scale, double xoff, double yoff, const sdf_options &opt )
+{
+	using namespace sdf_detail;
+	distance_field df;
+	df.width = df.height = opt.size;
+	df.channels = opt.msdf ? 3 : 1;
+	df.data.assign( df.width * df.height * df.channels, 0 );
+
+	std::vector<fseg> fs( segs.size() );
+	std::vector<int> contour_of( segs.size() );
+	double area = 0;
+	for ( size_t i = 0 ; i < segs.size() ; i++ ) {
+		const segment &s = segs[i];
+		fseg &f = fs[i];
+		f.quad = s.type == segment::quad;
+		f.color = WHITE;
+		f.x0 = s.p0.x*scale + xoff; f.y0 = s.p0.y*scale + yoff;
+		f.cx = s.c.x*scale + xoff;  f.cy = s.c.y*scale + yoff;
+		f.x1 = s.p1.x*scale + xoff; f.y1 = s.p1.y*scale + yoff;
+		f.xmin = std::min( f.x0, std::min( f.cx, f.x1 ) );
+		f.xmax = std::max( f.x0, std::max( f.cx, f.x1 ) );
+		f.ymin = std::min( f.y0, std::min( f.cy, f.y1 ) );
+		f.ymax = std::max( f.y0, std::max( f.cy, f.y1 ) );
+		contour_of[i] = s.contour;
+		area += cross( f.x0, f.y0, f.x1, f.y1 );
+	}
+	if (opt.msdf) color_edges( fs, contour_of );
+	// orientation of the 'side' cross product that means 'inside'
+	double inside_sign = area > 0 ? 1 : -1;
+
+	// segments by the top of their band, to be let into 'active' row by row
+	std::vector<size_t> order( fs.size() ), active;
+	for ( size_t i = 0 ; i < fs.size() ; i++ ) order[i] = i;
+	std::stable_sort( order.begin(), order.end(), [&]( size_t a, size_t b ) { return fs[a].ymin < fs[b].ymin; } );
+	size_t next = 0;
+
+	const int w = df.width;
+	std::vector<double> best( w*3 ), bestside( w*3 ), d2( w ), side( w );
+	std::vector<std::pair<double,int> > xs;
+	std::vector<bool> inside( w );
+	for ( int row = 0 ; row < df.height ; row++ ) {
+		double py = row + 0.5;
+
+		/* the segments within 'range' of the row: anything further clamps
+		anyway. Kept in outline order, as that decides which of two equally
+		close segments gives the side. */
+		bool added = false;
+		while (next < order.size() && py >= fs[order[next]].ymin - opt.range) {
+			active.push_back( order[next++] );
+			added = true;
+		}
+		active.erase( std::remove_if( active.begin(), active.end(),
+			[&]( size_t i ) { return py > fs[i].ymax + opt.range; } ), active.end() );
+		if (added) std::sort( active.begin(), active.end() );
+
+		// sign for the whole row from the non-zero winding rule
+		xs.clear();
+		for ( size_t a = 0 ; a < active.size() ; a++ ) crossings( fs[active[a]], py, xs );
+		std::sort( xs.begin(), xs.end() );
+		size_t k = 0;
+		int winding = 0;
+		for ( int col = 0 ; col < w ; col++ ) {
+			double px = col + 0.5;
+			while (k < xs.size() && xs[k].first <= px) winding += xs[k++].second;
+			inside[col] = winding != 0;
+		}
+
+		// distances, each segment swept across the columns near it
+		std::fill( best.begin(), best.end(), opt.range*opt.range );
+		std::fill( bestside.begin(), bestside.end(), 0.0 );
+		for ( size_t a = 0 ; a < active.size() ; a++ ) {
+			const fseg &f = fs[active[a]];
+			int c0 = std::max( 0, (int)ceil( f.xmin - opt.range - 0.5 ) );
+			int c1 = std::min( w - 1, (int)floor( f.xmax + opt.range - 0.5 ) );
+			if (c0 > c1) continue;
+			sweep( f, py, c0, c1, &d2[0], &side[0] );
+			for ( int col = c0 ; col <= c1 ; col++ ) {
+				for ( int ch = 0 ; ch < df.channels ; ch++ ) {
+					if (opt.msdf && !(f.color & (1<<ch))) continue;
+					int b = col*3 + ch;
+					if (d2[col] < best[b]) { best[b] = d2[col]; bestside[b] = side[col]; }
+				}
+			}
+		}
+
+		unsigned char *out = &df.data[ row * w * df.channels ];
+		for ( int col = 0 ; col < w ; col++ ) {
+			for ( int ch = 0 ; ch < df.channels ; ch++ ) {
+				int b = col*3 + ch;
+				double d = sqrt( best[b] );
+				bool in;
+				if (!opt.msdf || bestside[b] == 0) in = inside[col];
+				else in = bestside[b]*inside_sign > 0;
+				out[ col*df.channels + ch ] = encode( in ? d : -d, opt.range );
+			}
+		}
+	}
+	return df;
+}
+
+// Distance field of a glyph already loaded through the glyph class.
+inline distance_field make_distance_field( glyph &g, const sdf_options &opt )
+{
+	int pad = (int)ceil( opt.range );
+	int span = std::max( g.bbwidth, g.bbheight );
+	double scale = span > 0 ? double(opt.size - 2*pad) / span : 1;
+	distance_field df = make_distance_field( g.segments(), scale,
+		pad - g.face->bbox.xMin*scale, pad + g.face->bbox.yMax*scale, opt );
+	df.codepoint = g.codepoint;
+	return df;
+}
+
+/* Fields for many codepoints of one font. FreeType faces can not be shared
+between threads, so the outlines are pulled out of the face first, one
+after the other, and only then are the fields computed in parallel. Every
+glyph uses the same scale and baseline (from the face bounding box), so
+the fields line up when drawn as text. */
+inline std::vector<distance_field> make_distance_fields( ttf_file &file,
+	const std::vector<int> &codepoints, const sdf_options &opt )
+{
+	FT_Face face = file.face;
+	int bbwidth = face->bbox.xMax - face->bbox.xMin;
+	int bbheight = face->bbox.yMax - face->bbox.yMin;
+	int pad = (int)ceil( opt.range );
+	int span = std::max( bbwidth, bbheight );
+	double scale = span > 0 ? double(opt.size - 2*pad) / span : 1;
+	double xoff = pad - face->bbox.xMin*scale;
+	double yoff = pad + face->bbox.yMax*scale;
+
+	std::vector< std::vector<segment> > outlines( codepoints.size() );
+	for ( size_t i = 0 ; i < codepoints.size() ; i++ ) {
+		FT_UInt glyph_index = FT_Get_Char_Index( face, codepoints[i] );
+		if (FT_Load_Glyph( face, glyph_index, FT_LOAD_NO_SCALE )) continue;
+		const FT_Outline &o = face->glyph->outline;
+		outlines[i] = outline_segments( o.points, o.tags, o.contours, o.n_points, o.n_contours, true );
+	}
+
+	std::vector<distance_field> fields( codepoints.size() );
+	std::atomic<size_t> next( 0 );
+	int nthreads = opt.threads > 0 ? opt.threads : std::thread::hardware_concurrency();
+	if (nthreads < 1) nthreads = 1;
+	std::vector<std::thread> workers;
+	for ( int t = 0 ; t < nthreads ; t++ ) {
+		workers.push_back( std::thread( [&]() {
+			for ( size_t i = next++ ; i < codepoints.size() ; i = next++ ) {
+				fields[i] = make_distance_field( outlines[i], scale, xoff, yoff, opt );
+				fields[i].codepoint = codepoints[i];
+			}
+		} ) );
+	}
+	for ( size_t t = 0 ; t < workers.size() ; t++ ) workers[t].join();
+	return fields;
+}
+
+// Pack fields into a square-ish grid of equal cells.
+inline distance_atlas pack_atlas( const std::vector<distance_field> &fields, const sdf_options &opt )
+{
+	distance_atlas a;
+	a.cellsize = opt.size;
+	a.channels = opt.msdf ? 3 : 1;
+	int n = fields.size();
+	int cols = (int)ceil( sqrt( (double)std::max( n, 1 ) ) );
+	int rows = (n + cols - 1) / cols;
+	a.width = cols * a.cellsize;
+	a.height = std::max( rows, 1 ) * a.cellsize;
+	a.data.assign( a.width * a.height * a.channels, 0 );
+	for ( int i = 0 ; i < n ; i++ ) {
+		const distance_field &f = fields[i];
+		atlas_cell c;
+		c.codepoint = f.codepoint;
+		c.x = (i % cols) * a.cellsize;
+		c.y = (i / cols) * a.cellsize;
+		a.cells.push_back( c );
+		int rowbytes = f.width * f.channels;
+		for ( int y = 0 ; y < f.height ; y++ )
+			std::copy( &f.data[ y*rowbytes ], &f.data[ y*rowbytes ] + rowbytes,
+				&a.data[ ((c.y + y)*a.width + c.x) * a.channels ] );
+	}
+	return a;
+}
+
+// Binary PGM (1 channel) or PPM (3 channels) image.
+inline std::string netpbm( int width, int height, int channels, const std::vector<unsigned char> &data )
+{
+	text_stream tmp;
+	tmp << (channels == 3 ? "P6" : "P5") << "\n" << width << " " << height << "\n255\n";
+	tmp.write( (const char *)data.data(), data.size() );
+	return tmp.str();
+}
+
+inline std::string netpbm( const distance_field &f ) { return netpbm( f.width, f.height, f.channels, f.data ); }
+inline std::string netpbm( const distance_atlas &a ) { return netpbm( a.width, a.height, a.channels, a.data ); }
+
+} // namespace
+
+#endif
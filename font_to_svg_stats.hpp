@@ -0,0 +1,251 @@
+// font_to_svg_stats.hpp - where the time goes, per conversion stage
+// Copyright Don Bright 2013 <hugh.m.bright@gmail.com>
+/*
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+
+  License based on zlib license, by Jean-loup Gailly and Mark Adler
+*/
+
+/*
+
+Timers and counters for the stages of a conversion:
+
+ face_open   FT_New_Face / FT_New_Memory_Face
+ glyph_load  FT_Load_Glyph
+ copy        copying the outline out of FreeType's glyph slot
+ outline     walk_outline / flatten_outline: rebuilding the implied on-curve
+             points, and the output policy's calls (for svg output, writing
+             the path text)
+ format      the rest of the document text (header, transform, footer...)
+
+Times are exclusive: when one timed stage runs inside another, its time
+is only counted once, for the inner stage. Counters are glyphs, points,
+contours, bytes (of output, counted by the programs) and cache hits and
+misses (counted by whatever cache is in use).
+
+Everything is off unless FONT2SVG_INSTRUMENT is defined; without it the
+FONT2SVG_TIME and FONT2SVG_COUNT macros compile to nothing. Define it for
+the whole program, not for single files.
+
+When on, each thread gets its own block of counters, so there is no
+locking or shared cache line on the hot path; collect() adds the blocks
+up. When a thread ends, its numbers are added to a 'retired' total and
+its block is freed, so its work is still counted but a program that
+starts a thread per connection does not collect a block per connection.
+
+*/
+
+#ifndef __font_to_svg_stats_h__
+#define __font_to_svg_stats_h__
+
+#ifndef FONT2SVG_INSTRUMENT
+
+#define FONT2SVG_TIME( stage ) ((void)0)
+#define FONT2SVG_COUNT( counter, n ) ((void)0)
+
+#else
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <locale>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+namespace font2svg {
+namespace stats {
+
+enum stage { face_open, glyph_load, copy, outline, format, num_stages };
+enum counter { glyphs, points, contours, bytes, cache_hits, cache_misses, num_counters };
+
+inline const char *stage_names[num_stages] = { "face_open", "glyph_load", "copy", "outline", "format" };
+inline const char *counter_names[num_counters] = { "glyphs", "points", "contours", "bytes", "cache_hits", "cache_misses" };
+
+// One thread's numbers. Only that thread writes them; anyone may read.
+struct block
+{
+	std::atomic<uint64_t> ns[num_stages], calls[num_stages], count[num_counters];
+	block()
+	{
+		for ( int i = 0 ; i < num_stages ; i++ ) { ns[i] = 0; calls[i] = 0; }
+		for ( int i = 0 ; i < num_counters ; i++ ) count[i] = 0;
+	}
+};
+
+// All threads added up.
+struct totals
+{
+	uint64_t ns[num_stages], calls[num_stages], count[num_counters];
+	size_t threads; // running threads that have counted something
+};
+
+// blocks of the running threads, and the sums of the threads that ended
+inline std::mutex registry_lock;
+inline std::vector<block *> registry;
+inline totals retired = totals();
+
+inline void add( totals &t, const block &b )
+{
+	for ( int s = 0 ; s < num_stages ; s++ ) {
+		t.ns[s] += b.ns[s].load( std::memory_order_relaxed );
+		t.calls[s] += b.calls[s].load( std::memory_order_relaxed );
+	}
+	for ( int c = 0 ; c < num_counters ; c++ )
+		t.count[c] += b.count[c].load( std::memory_order_relaxed );
+}
+
+// A thread's block: registered when the thread first counts, retired when it ends
+struct owner
+{
+	block *b;
+	owner() : b( new block )
+	{
+		std::lock_guard<std::mutex> held( registry_lock );
+		registry.push_back( b );
+	}
+	~owner()
+	{
+		std::lock_guard<std::mutex> held( registry_lock );
+		add( retired, *b );
+		registry.erase( std::find( registry.begin(), registry.end(), b ) );
+		delete b;
+	}
+};
+
+// single writer: a plain load + store is enough, no locked add
+inline void bump( std::atomic<uint64_t> &a, uint64_t n )
+{
+	a.store( a.load( std::memory_order_relaxed ) + n, std::memory_order_relaxed );
+}
+
+inline block &mine()
+{
+	thread_local owner o;
+	return *o.b;
+}
+
+inline void count( counter c, uint64_t n ) { bump( mine().count[c], n ); }
+
+/* Times its own scope. Time spent in timers started inside this one is
+taken off, so each nanosecond is counted for one stage only. */
+class timer
+{
+public:
+	timer( stage s ) : which( s ), inner( 0 ), outer( current() )
+	{
+		current() = this;
+		start = std::chrono::steady_clock::now();
+	}
+	~timer()
+	{
+		uint64_t total = std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now() - start ).count();
+		block &b = mine();
+		bump( b.ns[which], total - inner );
+		bump( b.calls[which], 1 );
+		if (outer) outer->inner += total;
+		current() = outer;
+	}
+private:
+	stage which;
+	uint64_t inner;
+	timer *outer;
+	std::chrono::steady_clock::time_point start;
+	static timer *&current() { thread_local timer *t = NULL; return t; }
+	timer( const timer & );
+	timer &operator=( const timer & );
+};
+
+inline totals collect()
+{
+	std::lock_guard<std::mutex> held( registry_lock );
+	totals t = retired;
+	t.threads = registry.size();
+	for ( size_t i = 0 ; i < registry.size() ; i++ ) add( t, *registry[i] );
+	return t;
+}
+
+// Zero everything. Only exact when no other thread is converting.
+inline void reset()
+{
+	std::lock_guard<std::mutex> held( registry_lock );
+	retired = totals();
+	for ( size_t i = 0 ; i < registry.size() ; i++ ) {
+		for ( int s = 0 ; s < num_stages ; s++ ) { registry[i]->ns[s] = 0; registry[i]->calls[s] = 0; }
+		for ( int c = 0 ; c < num_counters ; c++ ) registry[i]->count[c] = 0;
+	}
+}
+
+inline double hit_rate( const totals &t )
+{
+	uint64_t n = t.count[cache_hits] + t.count[cache_misses];
+	return n ? double( t.count[cache_hits] ) / n : 0;
+}
+
+inline std::string json()
+{
+	totals t = collect();
+	std::stringstream tmp;
+	tmp.imbue( std::locale::classic() );
+	tmp << "{\"threads\": " << t.threads << ", \"stages\": {";
+	for ( int s = 0 ; s < num_stages ; s++ )
+		tmp << (s ? ", " : "") << "\"" << stage_names[s] << "\": {\"calls\": " << t.calls[s]
+			<< ", \"seconds\": " << t.ns[s] / 1e9 << "}";
+	tmp << "}";
+	for ( int c = 0 ; c < num_counters ; c++ )
+		tmp << ", \"" << counter_names[c] << "\": " << t.count[c];
+	tmp << ", \"cache_hit_rate\": " << hit_rate( t ) << "}\n";
+	return tmp.str();
+}
+
+// Prometheus text exposition format
+inline std::string prometheus()
+{
+	totals t = collect();
+	std::stringstream tmp;
+	tmp.imbue( std::locale::classic() );
+	tmp << "# HELP font2svg_stage_seconds_total Time spent in each conversion stage.\n"
+		<< "# TYPE font2svg_stage_seconds_total counter\n";
+	for ( int s = 0 ; s < num_stages ; s++ )
+		tmp << "font2svg_stage_seconds_total{stage=\"" << stage_names[s] << "\"} " << t.ns[s] / 1e9 << "\n";
+	tmp << "# HELP font2svg_stage_calls_total Times each conversion stage ran.\n"
+		<< "# TYPE font2svg_stage_calls_total counter\n";
+	for ( int s = 0 ; s < num_stages ; s++ )
+		tmp << "font2svg_stage_calls_total{stage=\"" << stage_names[s] << "\"} " << t.calls[s] << "\n";
+	for ( int c = 0 ; c < num_counters ; c++ )
+		tmp << "# TYPE font2svg_" << counter_names[c] << "_total counter\n"
+			<< "font2svg_" << counter_names[c] << "_total " << t.count[c] << "\n";
+	tmp << "# TYPE font2svg_cache_hit_ratio gauge\n"
+		<< "font2svg_cache_hit_ratio " << hit_rate( t ) << "\n";
+	return tmp.str();
+}
+
+} // namespace stats
+} // namespace font2svg
+
+#define FONT2SVG_CAT2( a, b ) a##b
+#define FONT2SVG_CAT( a, b ) FONT2SVG_CAT2( a, b )
+#define FONT2SVG_TIME( stage ) font2svg::stats::timer FONT2SVG_CAT( font2svg_timer_, __LINE__ )( font2svg::stats::stage )
+#define FONT2SVG_COUNT( counter, n ) font2svg::stats::count( font2svg::stats::counter, n )
+
+#endif // FONT2SVG_INSTRUMENT
+
+#endif
@@ -0,0 +1,316 @@
+// font_to_svg_stroke.hpp - outlined and bold glyphs, as fill-only paths
+// Copyright Don Bright 2013 <hugh.m.bright@gmail.com>
+/*
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+
+  License based on zlib license, by Jean-loup Gailly and Mark Adler
+*/
+
+/*
+
+Outlined or bold text used to be made by asking the svg renderer to
+stroke the path with a wide stroke-width, which is slow to draw at large
+sizes and not drawn the same by every renderer. Here the stroke is worked
+out once, at conversion time, by FreeType's stroker, and written as an
+ordinary filled path:
+
+ stroke_ring   the band 'radius' wide either side of the outline
+               (outlined text: draw it over or under the plain glyph)
+ stroke_bold   the glyph grown by 'radius' all round (faux bold)
+
+The stroker draws round joins as cubic Beziers. Everything else here
+(walk_outline, flat_op, the output policies) knows only lines and
+quadratics, so each cubic is split into quadratics that stay within a
+quarter of a font unit of it. The result is kept as an outline_data, like
+the plain outline, so it goes through emit() to any output policy.
+
+A stroker works on one face (one thread, like the face) and keeps every
+stroked outline it makes, by glyph, radius and style, until clear().
+Radii are in font units.
+
+FreeType's stroker does not untangle an offset that folds over itself,
+which happens when the radius is more than half the width of a counter
+or stem (the hole of a small 'o', say). Parts of the glyph can then come
+out unfilled. Radii up to a few percent of the em are safe.
+
+ ftstroke: https://freetype.org/freetype2/docs/reference/ft2-glyph_stroker.html
+
+*/
+
+#ifndef __font_to_svg_stroke_h__
+#define __font_to_svg_stroke_h__
+
+#include "font_to_svg.hpp"
+#include FT_STROKER_H
+#include <cmath>
+#include <map>
+#include <tuple>
+
+namespace font2svg {
+
+enum stroke_style { stroke_ring, stroke_bold };
+
+/* Builds an outline of on-curve points and quadratic control points
+through FT_Outline_Decompose, splitting cubics. Contours come closed
+back to their first point; that last point is dropped, as TrueType
+contours close themselves. */
+struct quadratic_outline
+{
+	std::vector<FT_Vector> points;
+	std::vector<char> tags;
+	std::vector<short> contours;
+
+	void point( double x, double y, char tag )
+	{
+		FT_Vector v;
+		v.x = lround( x );
+		v.y = lround( y );
+		points.push_back( v );
+		tags.push_back( tag );
+	}
+
+	// lines and curves that go nowhere (the stroker's tiny arcs, once
+	// rounded) are left out
+	bool here( double x, double y ) const
+	{
+		return points.size() && tags.back() == FT_CURVE_TAG_ON
+			&& points.back().x == lround( x ) && points.back().y == lround( y );
+	}
+	void line( double x, double y )
+	{
+		if (!here( x, y )) point( x, y, FT_CURVE_TAG_ON );
+	}
+	void quad( double cx, double cy, double x, double y )
+	{
+		if (here( cx, cy ) && here( x, y )) return;
+		point( cx, cy, FT_CURVE_TAG_CONIC );
+		point( x, y, FT_CURVE_TAG_ON );
+	}
+
+	void end_contour()
+	{
+		size_t first = contours.size() ? contours.back() + 1 : 0;
+		if (points.size() > first + 1 && tags.back() == FT_CURVE_TAG_ON
+			&& points.back().x == points[first].x && points.back().y == points[first].y) {
+			points.pop_back();
+			tags.pop_back();
+		}
+		// fewer than three points enclose nothing
+		if (points.size() < first + 3) {
+			points.resize( first );
+			tags.resize( first );
+		} else {
+			contours.push_back( points.size() - 1 );
+		}
+	}
+
+	// a cubic from 'p' as n quadratics, each with the control point that
+	// best fits its piece of the cubic
+	void cubic( const FT_Vector &p, const FT_Vector &c1, const FT_Vector &c2, const FT_Vector &to )
+	{
+		double ex = to.x - 3.0 * c2.x + 3.0 * c1.x - p.x;
+		double ey = to.y - 3.0 * c2.y + 3.0 * c1.y - p.y;
+		double err = sqrt( ex * ex + ey * ey ) * sqrt( 3.0 ) / 36;
+		int n = std::min( std::max( (int)ceil( cbrt( err / 0.25 ) ), 1 ), 64 );
+		double ax = p.x, ay = p.y;
+		for ( int i = 1 ; i <= n ; i++ ) {
+			// the piece [t0,t1] of the cubic, by its points and end tangents
+			double t0 = double( i - 1 ) / n, t1 = double( i ) / n;
+			double bx, by, dx0, dy0, dx1, dy1;
+			at( p, c1, c2, to, t0, bx, by, dx0, dy0 );
+			at( p, c1, c2, to, t1, bx, by, dx1, dy1 );
+			double h = ( t1 - t0 ) / 3;
+			// sub-cubic control points a + h d0 and b - h d1, then (3(c1+c2) - a - b) / 4
+			double cx = ( 3 * ( ax + h * dx0 + bx - h * dx1 ) - ax - bx ) / 4;
+			double cy = ( 3 * ( ay + h * dy0 + by - h * dy1 ) - ay - by ) / 4;
+			if (i == n) quad( cx, cy, to.x, to.y );
+			else quad( cx, cy, bx, by );
+			ax = bx;
+			ay = by;
+		}
+	}
+
+	// point and derivative of a cubic at t
+	static void at( const FT_Vector &p, const FT_Vector &c1, const FT_Vector &c2, const FT_Vector &to,
+		double t, double &x, double &y, double &dx, double &dy )
+	{
+		double s = 1 - t;
+		x = s*s*s * p.x + 3*s*s*t * c1.x + 3*s*t*t * c2.x + t*t*t * to.x;
+		y = s*s*s * p.y + 3*s*s*t * c1.y + 3*s*t*t * c2.y + t*t*t * to.y;
+		dx = 3 * ( s*s * ( c1.x - p.x ) + 2*s*t * ( c2.x - c1.x ) + t*t * ( to.x - c2.x ) );
+		dy = 3 * ( s*s * ( c1.y - p.y ) + 2*s*t * ( c2.y - c1.y ) + t*t * ( to.y - c2.y ) );
+	}
+
+	static quadratic_outline &self( void *user ) { return *(quadratic_outline *)user; }
+	static int move_to( const FT_Vector *to, void *user )
+	{
+		quadratic_outline &q = self( user );
+		if (q.points.size() > (q.contours.size() ? (size_t)q.contours.back() + 1 : 0)) q.end_contour();
+		q.point( to->x, to->y, FT_CURVE_TAG_ON );
+		return 0;
+	}
+	static int line_to( const FT_Vector *to, void *user )
+	{
+		self( user ).line( to->x, to->y );
+		return 0;
+	}
+	static int conic_to( const FT_Vector *c, const FT_Vector *to, void *user )
+	{
+		self( user ).quad( c->x, c->y, to->x, to->y );
+		return 0;
+	}
+	static int cubic_to( const FT_Vector *c1, const FT_Vector *c2, const FT_Vector *to, void *user )
+	{
+		quadratic_outline &q = self( user );
+		FT_Vector p = q.points.back();
+		q.cubic( p, *c1, *c2, *to );
+		return 0;
+	}
+
+	void read( const FT_Outline &o )
+	{
+		FT_Outline_Funcs funcs = { move_to, line_to, conic_to, cubic_to, 0, 0 };
+		points.reserve( o.n_points * 2 );
+		tags.reserve( o.n_points * 2 );
+		FT_Outline_Decompose( const_cast<FT_Outline *>( &o ), &funcs, this );
+		if (points.size() > (contours.size() ? (size_t)contours.back() + 1 : 0)) end_contour();
+	}
+
+	// a view of the arrays, for outline_data
+	FT_Outline outline()
+	{
+		FT_Outline o = FT_Outline();
+		o.n_points = points.size();
+		o.n_contours = contours.size();
+		o.points = points.size() ? &points[0] : NULL;
+		o.tags = tags.size() ? &tags[0] : NULL;
+		o.contours = contours.size() ? &contours[0] : NULL;
+		return o;
+	}
+};
+
+class stroker
+{
+public:
+	/* 'join' is how corners are joined (FT_STROKER_LINEJOIN_ROUND,
+	_BEVEL, _MITER_FIXED...). 'miter_limit' is in 16.16 fixed point. */
+	stroker( ttf_file &f, FT_Stroker_LineJoin join = FT_STROKER_LINEJOIN_ROUND,
+		FT_Fixed miter_limit = 4 << 16 )
+		: library( f.library ), ft_stroker( NULL ), line_join( join ), miter( miter_limit )
+	{
+		FT_Stroker_New( library, &ft_stroker );
+	}
+
+	~stroker()
+	{
+		if (ft_stroker) FT_Stroker_Done( ft_stroker );
+	}
+
+	// The stroked outline of a glyph, made on first use
+	std::shared_ptr<const outline_data> shape( glyph &g, long radius, stroke_style style = stroke_ring )
+	{
+		std::tuple<FT_UInt, long, int> key( g.index, radius, style );
+		std::map< std::tuple<FT_UInt, long, int>, std::shared_ptr<const outline_data> >::iterator
+			it = shapes.find( key );
+		if (it != shapes.end()) {
+			FONT2SVG_COUNT( cache_hits, 1 );
+			return it->second;
+		}
+		FONT2SVG_COUNT( cache_misses, 1 );
+		return shapes[key] = stroke( g.ftoutline, radius, style );
+	}
+
+	// The stroked outline through any output policy, as glyph::emit()
+	template <class Policy>
+	void emit( glyph &g, long radius, stroke_style style, Policy &out, bool flip = false )
+	{
+		play( shape( g, radius, style )->path, out, flip );
+	}
+
+	/* An svg document with the stroked glyph as one filled path. As the
+	plain document, but the page and margin are 'radius' bigger all round,
+	for what the stroke adds. */
+	std::string document( glyph &g, long radius, stroke_style style = stroke_ring )
+	{
+		FONT2SVG_TIME( format );
+		long grow = radius > 0 ? radius : 0;
+		svg_compact path;
+		emit( g, radius, style, path );
+		text_stream out;
+		out << "\n<svg width='" << g.bbwidth + 2*grow << "px'"
+			<< " height='" << g.bbheight + 2*grow << "px'"
+			<< " xmlns='http://www.w3.org/2000/svg' version='1.1'>"
+			<< "\n\n <!-- make sure glyph is visible within svg window -->"
+			<< "\n <g fill-rule='nonzero' "
+			<< " transform='translate(" << 100 + grow << " "
+			<< g.gm.horiBearingY + g.gm.vertBearingY + 100 + grow << ")'>"
+			<< "\n\n  <path fill='black' d='" << path.svg.str() << "'/>"
+			<< g.svgfooter();
+		return out.str();
+	}
+
+	size_t cached() const { return shapes.size(); }
+
+	// Forget the stroked outlines (after changing the face's instance)
+	void clear() { shapes.clear(); }
+
+private:
+	FT_Library library;
+	FT_Stroker ft_stroker;
+	FT_Stroker_LineJoin line_join;
+	FT_Fixed miter;
+	std::map< std::tuple<FT_UInt, long, int>, std::shared_ptr<const outline_data> > shapes;
+
+	stroker( const stroker & );
+	stroker &operator=( const stroker & );
+
+	std::shared_ptr<const outline_data> stroke( const FT_Outline &o, long radius, stroke_style style )
+	{
+		FONT2SVG_TIME( outline );
+		FT_Outline stroked = FT_Outline();
+		FT_UInt n_points = 0, n_contours = 0;
+		bool ok = ft_stroker && o.n_points > 0 && o.n_contours > 0 && radius > 0;
+		if (ok) {
+			FT_Stroker_Set( ft_stroker, radius, FT_STROKER_LINECAP_BUTT, line_join, miter );
+			ok = !FT_Stroker_ParseOutline( ft_stroker, const_cast<FT_Outline *>( &o ), 0 );
+		}
+		// the outside border alone is the glyph grown by the radius
+		FT_StrokerBorder border = FT_Outline_GetOutsideBorder( const_cast<FT_Outline *>( &o ) );
+		if (ok && style == stroke_bold)
+			ok = !FT_Stroker_GetBorderCounts( ft_stroker, border, &n_points, &n_contours );
+		else if (ok)
+			ok = !FT_Stroker_GetCounts( ft_stroker, &n_points, &n_contours );
+		bool made = ok && !FT_Outline_New( library, n_points, n_contours, &stroked );
+		if (made) {
+			stroked.n_points = stroked.n_contours = 0;
+			if (style == stroke_bold) FT_Stroker_ExportBorder( ft_stroker, border, &stroked );
+			else FT_Stroker_Export( ft_stroker, &stroked );
+		}
+		// a ring of no width is empty; a glyph grown by nothing is the glyph
+		quadratic_outline q;
+		if (made) q.read( stroked );
+		else if (style == stroke_bold) q.read( o );
+		if (made) FT_Outline_Done( library, &stroked );
+		FT_Outline view = q.outline();
+		return std::make_shared<outline_data>( view, std::pmr::get_default_resource() );
+	}
+};
+
+} // namespace
+
+#endif
@@ -0,0 +1,163 @@
+// font_to_svg_ttc.hpp - TrueType (R) collections (.ttc/.otc)
+// Copyright Don Bright 2013 <hugh.m.bright@gmail.com>
+/*
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+
+  License based on zlib license, by Jean-loup Gailly and Mark Adler
+*/
+
+/*
+
+A collection file packs several faces (for example the Regular, Bold,
+Japanese and Chinese cuts of a CJK family) into one file, and the faces
+share most of their tables (glyf, CFF, ...). font_collection maps the file
+into memory once and opens every face on top of that same mapping, so the
+shared tables are only ever read from one place.
+
+FreeType faces must not be used from two threads at once, so each face
+gets its own FT_Library and is worked on by one thread only.
+
+ TTC header: https://learn.microsoft.com/typography/opentype/spec/otff#font-collections
+
+*/
+
+#ifndef __font_to_svg_ttc_h__
+#define __font_to_svg_ttc_h__
+
+#include "font_to_svg.hpp"
+#include <fstream>
+#include <thread>
+#include <atomic>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#define FONT2SVG_HAVE_MMAP 1
+#endif
+
+namespace font2svg {
+
+class font_collection
+{
+public:
+	std::string filename;
+	const unsigned char *data;
+	size_t size;
+	int num_faces;
+
+	font_collection( std::string fname )
+	{
+		filename = fname;
+		data = NULL;
+		size = 0;
+		mapped = false;
+#ifdef FONT2SVG_HAVE_MMAP
+		int fd = open( filename.c_str(), O_RDONLY );
+		struct stat st;
+		if (fd >= 0 && fstat( fd, &st ) == 0 && st.st_size > 0) {
+			void *p = mmap( NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0 );
+			if (p != MAP_FAILED) {
+				data = (const unsigned char *)p;
+				size = st.st_size;
+				mapped = true;
+			}
+		}
+		if (fd >= 0) close( fd );
+#endif
+		if (!mapped) {
+			std::ifstream in( filename.c_str(), std::ios::binary );
+			buffer.assign( std::istreambuf_iterator<char>( in ), std::istreambuf_iterator<char>() );
+			data = buffer.size() ? &buffer[0] : NULL;
+			size = buffer.size();
+		}
+		if (!data) {
+			std::cerr << "problem loading file " << filename << "\n";
+			exit(1);
+		}
+
+		// face index -1 only reads the header, to count the faces
+		FT_Library library;
+		FT_Face face;
+		num_faces = 0;
+		FT_Init_FreeType( &library );
+		if (!FT_New_Memory_Face( library, data, size, -1, &face )) {
+			num_faces = face->num_faces;
+			FT_Done_Face( face );
+		}
+		FT_Done_FreeType( library );
+	}
+
+	// Open one face. Call free() on it before the collection goes away.
+	ttf_file face( int face_index )
+	{
+		return ttf_file( data, size, face_index, filename );
+	}
+
+	void free()
+	{
+#ifdef FONT2SVG_HAVE_MMAP
+		if (mapped) munmap( (void *)data, size );
+#endif
+		mapped = false;
+		buffer.clear();
+		data = NULL;
+		size = 0;
+	}
+
+	/* Convert the same characters out of every face, faces in parallel.
+	Result is indexed [face][character]; each entry is an svg document.
+	Set font2svg::quiet first: without it every worker thread prints its
+	debug output to std::cout, mixed in with the others'. */
+	std::vector< std::vector<std::string> > convert( const std::vector<int> &codepoints, int threads = 0 )
+	{
+		std::vector<ttf_file> faces;
+		for ( int i = 0 ; i < num_faces ; i++ ) faces.push_back( face( i ) );
+
+		std::vector< std::vector<std::string> > result( num_faces );
+		std::atomic<int> next( 0 );
+		if (threads <= 0) threads = std::thread::hardware_concurrency();
+		if (threads < 1) threads = 1;
+		std::vector<std::thread> workers;
+		for ( int t = 0 ; t < threads && t < num_faces ; t++ ) {
+			workers.push_back( std::thread( [&]() {
+				for ( int i = next++ ; i < num_faces ; i = next++ ) {
+					for ( size_t c = 0 ; c < codepoints.size() ; c++ ) {
+						FT_UInt glyph_index = FT_Get_Char_Index( faces[i].face, codepoints[c] );
+						glyph g( faces[i], codepoints[c], glyph_index, "" );
+						result[i].push_back( g.svgheader() + g.svgtransform() + g.outline() + g.svgfooter() );
+					}
+				}
+			} ) );
+		}
+		for ( size_t t = 0 ; t < workers.size() ; t++ ) workers[t].join();
+		for ( size_t i = 0 ; i < faces.size() ; i++ ) faces[i].free();
+		return result;
+	}
+
+private:
+	bool mapped;
+	std::vector<unsigned char> buffer;
+	font_collection( const font_collection & );
+	font_collection &operator=( const font_collection & );
+};
+
+} // namespace
+
+#endif
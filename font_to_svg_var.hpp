@@ -0,0 +1,126 @@
+// font_to_svg_var.hpp - many instances of a variable TrueType (R) font
+// Copyright Don Bright 2013 <hugh.m.bright@gmail.com>
+/*
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+
+  License based on zlib license, by Jean-loup Gailly and Mark Adler
+*/
+
+/*
+
+A variable font holds a whole family (weights, widths, ...) in one file.
+Each 'instance' is picked by a position on the design axes. Only the
+point positions depend on that position; the character map, the glyph
+indexes and the glyph names are the same for every instance. So an
+instance_set looks those up once, and each call to render() only loads
+and converts the outlines.
+
+ OpenType font variations: https://learn.microsoft.com/typography/opentype/spec/otvaroverview
+ FType variations: http://www.freetype.org/freetype2/docs/reference/ft2-multiple_masters.html
+
+*/
+
+#ifndef __font_to_svg_var_h__
+#define __font_to_svg_var_h__
+
+#include "font_to_svg.hpp"
+#include <map>
+
+namespace font2svg {
+
+// The svg documents of every requested character, for one instance.
+struct instance
+{
+	std::vector<double> coords;
+	std::vector<std::string> svgs;
+};
+
+class instance_set
+{
+public:
+	struct entry
+	{
+		int codepoint;
+		FT_UInt glyph_index;
+		std::string glyph_name;
+	};
+
+	ttf_file file;
+	std::vector<entry> entries;
+
+	instance_set( ttf_file &f, std::vector<int> codepoints )
+	{
+		file = f;
+		char glyph_name[1024];
+		for ( size_t i = 0 ; i < codepoints.size() ; i++ ) {
+			entry e;
+			e.codepoint = codepoints[i];
+			e.glyph_index = FT_Get_Char_Index( file.face, e.codepoint );
+			glyph_name[0] = 0;
+			FT_Get_Glyph_Name( file.face, e.glyph_index, glyph_name, 1024 );
+			e.glyph_name = glyph_name;
+			entries.push_back( e );
+		}
+	}
+
+	/* Turn a spec like "wght=700,wdth=75" into design coordinates.
+	Axes not mentioned keep their default. */
+	std::vector<double> coordinates( std::string spec )
+	{
+		std::vector<var_axis> axes = file.axes();
+		std::map<std::string,double> given;
+		std::stringstream ss( spec );
+		std::string item;
+		while (std::getline( ss, item, ',' )) {
+			size_t eq = item.find( '=' );
+			if (eq == std::string::npos) continue;
+			given[ item.substr( 0, eq ) ] = strtod( item.c_str() + eq + 1, NULL );
+		}
+		std::vector<double> coords;
+		for ( size_t i = 0 ; i < axes.size() ; i++ ) {
+			if (given.count( axes[i].tag )) coords.push_back( given[ axes[i].tag ] );
+			else coords.push_back( axes[i].def );
+		}
+		return coords;
+	}
+
+	// Convert every character at one position in the design space.
+	instance render( std::vector<double> coords )
+	{
+		instance result;
+		result.coords = coords;
+		if (file.is_variable()) file.set_design_coordinates( coords );
+		for ( size_t i = 0 ; i < entries.size() ; i++ ) {
+			glyph g( file, entries[i].codepoint, entries[i].glyph_index, entries[i].glyph_name.c_str() );
+			result.svgs.push_back( g.svgheader() + g.svgtransform() + g.outline() + g.svgfooter() );
+		}
+		return result;
+	}
+
+	std::vector<instance> render( std::vector< std::vector<double> > many )
+	{
+		std::vector<instance> result;
+		for ( size_t i = 0 ; i < many.size() ; i++ )
+			result.push_back( render( many[i] ) );
+		return result;
+	}
+};
+
+} // namespace
+
+#endif